@@ -0,0 +1,1072 @@
+/*
+  NativeBench.cpp
+
+  Benchmark of the native environment. Runs the firmware on simulated time
+  against the stand-ins in lib/NativeHAL and prints throughput and latency
+  figures:
+
+    pio run -e native_bench && .pio/build/native_bench/program
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include <HID-Project.h>
+#include <HRawHID.h>
+#include <util/crc16.h>
+#include "NativeHAL.h"
+#include "configprotocol.h"
+#include "combo.h"
+#include "debounce.h"
+#include "encoder.h"
+#include "expander.h"
+#include "keypad.h"
+#include "keyscan.h"
+#include "macro.h"
+#include "mousekeys.h"
+#include "rotary.h"
+#include "taphold.h"
+
+#define BENCH_LOOP_US 100     // simulated duration of one loop() pass
+#define BENCH_ENCODER_EDGE_US 10 // between the quadrature edges of a turn, a fast flick
+
+extern enum TEncoderAction encoderAction[NUMBER_OF_ENCODERS][NUMBER_OF_LAYERS];
+extern enum TEncoderCurve encoderLayerCurve[NUMBER_OF_ENCODERS][NUMBER_OF_LAYERS];
+bool checkKeys(uint32_t now);
+
+static const uint8_t benchPins[] = {9, 8, 7, 6, 10, 16, 14, 15};
+
+// Runs loop() and advances the clock, returns number of passes
+static uint32_t runFor(uint32_t us)
+{
+  uint32_t passes = 0;
+  for (uint32_t t = 0; t < us; t += BENCH_LOOP_US) {
+    loop();
+    nativeAdvanceUs(BENCH_LOOP_US);
+    passes++;
+  }
+  return passes;
+}
+
+// Turns the encoder by quadrature steps, positive clockwise (CLK leads). The pins are active low,
+// their edges run the pin interrupts like on the board.
+static void encoderTurn(int16_t steps)
+{
+  static const uint8_t gray[4] = {0, 1, 3, 2}; // DT << 1 | CLK
+  static uint8_t phase;
+  for (int16_t i = 0; i != steps; i += (steps > 0) ? 1 : -1) {
+    phase = (phase + ((steps > 0) ? 1 : 3)) & 3;
+    nativeSetPin(encoderPin[0], (gray[phase] & 1) ? LOW : HIGH);
+    nativeSetPin(encoderPin[1], (gray[phase] & 2) ? LOW : HIGH);
+    nativeAdvanceUs(BENCH_ENCODER_EDGE_US);
+  }
+}
+
+// First keyboard report sent at or after the index, or NULL
+static const TNativeReport *nextKeyboardReport(uint32_t *index)
+{
+  for (; *index < nativeReportCount(); (*index)++) {
+    const TNativeReport *report = nativeReport(*index);
+    if (report->id == HID_REPORTID_KEYBOARD) {
+      return report;
+    }
+  }
+  return 0;
+}
+
+// Presses every key in turn and measures time from the pin edge to the keyboard report, keys of a
+// combo alone separately
+static void benchScan()
+{
+  const uint32_t events = 400;
+  uint32_t passes = 0;
+  uint32_t worstUs = 0;
+  uint64_t sumUs = 0;
+  uint32_t measured = 0;
+  uint64_t comboSumUs = 0;
+  uint32_t comboMeasured = 0;
+  uint32_t keyboardReports = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < events; i++) {
+    uint8_t pin = benchPins[i % sizeof(benchPins)];
+    uint32_t first = nativeReportCount();
+    uint32_t edgeUs = micros();
+    nativeSetPin(pin, LOW);
+    passes += runFor(60000);
+    nativeSetPin(pin, HIGH);
+    passes += runFor(100000);
+
+    const TNativeReport *report = nextKeyboardReport(&first);
+    if ((report) && (comboMemberKeys() & ((TKeyMask)1 << (i % sizeof(benchPins))))) {
+      comboSumUs += report->timeUs - edgeUs;
+      comboMeasured++;
+    }
+    else if (report) {
+      uint32_t latencyUs = report->timeUs - edgeUs;
+      worstUs = (latencyUs > worstUs) ? latencyUs : worstUs;
+      sumUs += latencyUs;
+      measured++;
+    }
+    for (; nextKeyboardReport(&first); first++) {
+      keyboardReports++;
+    }
+    nativeClearReports();
+  }
+  double hostS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("scan FSM: %u passes in %.3f s host time = %.0f scans/s\n", passes, hostS, passes / hostS);
+  printf("key press to report (simulated, %u us per pass): avg %.2f ms, worst %.2f ms, combo keys alone avg %.2f ms, %u/%u events reported, %.2f keyboard reports per event\n",
+         BENCH_LOOP_US, measured ? sumUs / 1000.0 / measured : 0.0, worstUs / 1000.0,
+         comboMeasured ? comboSumUs / 1000.0 / comboMeasured : 0.0, measured + comboMeasured, events, (double)keyboardReports / events);
+}
+
+static constexpr uint8_t matrixRows[] = {9, 8, 10, 16, 14, 15, 18, 19};
+static constexpr uint8_t matrixCols[] = {21, 20, 5, 0, 1, 22, 23, 7};
+
+// Matrix scan of the given size: every key alone, the corners of a rectangle, the time one scan
+// spends waiting for the lines (simulated) and scans per second of the host
+template <uint8_t Rows, uint8_t Cols, bool Diodes>
+static void benchMatrixSize()
+{
+  typedef TKeyMatrix<matrixRows, Rows, matrixCols, Cols, Diodes, 10> TMatrix;
+  nativeMatrix(matrixRows, Rows, matrixCols, Cols, Diodes);
+  TMatrix::begin();
+  nativeAdvanceUs(100);
+
+  uint32_t alone = 0;
+  uint32_t startUs = micros();
+  for (uint8_t i = 0; i < Rows * Cols; i++) {
+    nativeSetMatrixKey(i / Cols, i % Cols, true);
+    alone += TMatrix::scan() == (uint64_t)1 << i;
+    nativeSetMatrixKey(i / Cols, i % Cols, false);
+  }
+  uint32_t scanUs = (micros() - startUs) / (Rows * Cols);
+
+  // three corners first, then the fourth: without diodes the third and the fourth key wait until
+  // the rectangle is gone, the matrix reads the same for three and four keys
+  nativeSetMatrixKey(0, 0, true);
+  nativeSetMatrixKey(0, 1, true);
+  TMatrix::scan();
+  nativeSetMatrixKey(1, 0, true);
+  uint64_t three = TMatrix::scan();
+  nativeSetMatrixKey(1, 1, true);
+  uint64_t four = TMatrix::scan();
+  uint64_t corners = 1 | 2 | ((uint64_t)1 << Cols);
+  bool threeRight = Diodes ? (three == corners) : (three == 3);
+  bool fourRight = Diodes ? (four == (corners | ((uint64_t)2 << Cols))) : (four == 3);
+  for (uint8_t i = 0; i < 4; i++) {
+    nativeSetMatrixKey(i / 2, i % 2, false);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  const uint32_t scans = 100000;
+  for (uint32_t i = 0; i < scans; i++) {
+    TMatrix::scan();
+  }
+  double hostS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("matrix %ux%u %s: scan %u us of settle time, %u/%u keys alone read, three corners %s, four corners %s, host %.0f scans/s\n",
+         Rows, Cols, Diodes ? "with diodes" : "without diodes", scanUs, alone, Rows * Cols,
+         threeRight ? (Diodes ? "read" : "held back") : "WRONG", fourRight ? (Diodes ? "read" : "held back") : "WRONG", scans / hostS);
+  nativeMatrix(0, 0, 0, 0, true);
+}
+
+static void benchMatrix()
+{
+  benchMatrixSize<6, 6, true>();
+  benchMatrixSize<6, 6, false>();
+  benchMatrixSize<8, 8, true>();
+}
+
+// Reads of the expanders the way keyScan() takes them, a pass of BENCH_LOOP_US takes the last
+// finished read and starts the next one. Prints the fresh reads per second the scan gets (the
+// rate the expander keys are sampled at), every key alone, a missing chip and the worst time from
+// a press to its bit in the scan.
+static void benchExpanderBus(uint8_t type, uint8_t chips, uint8_t present)
+{
+  const uint8_t inputs = (type == EXPANDER_MCP23017) ? 16 : 8;
+  nativeExpanders((type == EXPANDER_MCP23017) ? present : 0, (type == EXPANDER_74HC165) ? present : 0, EXPANDER_LOAD_PIN);
+  expanderBegin(type, chips);
+
+  uint16_t readsBefore = expanderReads();
+  uint32_t bytesBefore = nativeExpanderBytes();
+  for (uint32_t t = 0; t < 1000000; t += BENCH_LOOP_US) {
+    expanderKeys();
+    expanderStart();
+    nativeAdvanceUs(BENCH_LOOP_US);
+  }
+  uint16_t reads = expanderReads() - readsBefore;
+  uint32_t bytes = nativeExpanderBytes() - bytesBefore;
+
+  uint32_t alone = 0, worstUs = 0;
+  for (uint8_t i = 0; i < chips * inputs; i++) {
+    nativeSetExpanderKey(i / inputs, i % inputs, true);
+    uint32_t pressUs = micros();
+    uint64_t keys = 0;
+    for (uint32_t t = 0; (t < 10000) && (!keys); t += BENCH_LOOP_US) {
+      keys = expanderKeys();
+      expanderStart();
+      nativeAdvanceUs(BENCH_LOOP_US);
+    }
+    uint32_t seenUs = micros() - BENCH_LOOP_US - pressUs;
+    worstUs = ((keys) && (seenUs > worstUs)) ? seenUs : worstUs;
+    alone += (keys == (uint64_t)1 << i) || ((i / inputs >= present) && (!keys));
+    nativeSetExpanderKey(i / inputs, i % inputs, false);
+    for (uint16_t started = expanderReads(); (uint16_t)(expanderReads() - started) < 2;) {
+      expanderStart();
+      nativeAdvanceUs(BENCH_LOOP_US);
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  const uint32_t scans = 100000;
+  for (uint32_t i = 0; i < scans; i++) {
+    expanderKeys();
+    expanderStart();
+    nativeAdvanceUs(BENCH_LOOP_US);
+  }
+  double hostS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("expander %u x %s (%u answering), %u keys: %u reads/s (%s 1 kHz), %.1f bus bytes per read, %u/%u keys alone read, press to scan worst %.2f ms, host %.0f scans/s\n",
+         chips, (type == EXPANDER_MCP23017) ? "MCP23017" : "74HC165", present, chips * inputs, reads,
+         (reads >= 1000) ? "at or above" : "BELOW", (double)bytes / reads, alone, chips * inputs, worstUs / 1000.0, scans / hostS);
+  expanderBegin(EXPANDER_NONE, 0);
+  nativeExpanders(0, 0, 0);
+}
+
+static void benchExpander()
+{
+  benchExpanderBus(EXPANDER_MCP23017, 2, 2);
+  benchExpanderBus(EXPANDER_MCP23017, 4, 4);
+  benchExpanderBus(EXPANDER_MCP23017, 4, 3);
+  benchExpanderBus(EXPANDER_74HC165, 4, 4);
+  benchExpanderBus(EXPANDER_74HC165, 8, 8);
+}
+
+// Presses all keys one pass after another and releases them 60 ms later. Counts the keyboard reports
+// per USB frame, the keys the host saw pressed and the longest loop() pass (USB_Send() waits for
+// a full endpoint bank).
+static void benchBurst()
+{
+  uint32_t longestUs = 0;
+  uint32_t seen = 0;
+  for (uint32_t t = 0; t < 200000; t += BENCH_LOOP_US) {
+    for (uint8_t i = 0; i < sizeof(benchPins); i++) {
+      uint32_t pressUs = i * BENCH_LOOP_US;
+      nativeSetPin(benchPins[i], ((t >= pressUs) && (t < pressUs + 60000)) ? LOW : HIGH);
+    }
+    uint32_t startUs = micros();
+    loop();
+    longestUs = (micros() - startUs > longestUs) ? micros() - startUs : longestUs;
+    nativeAdvanceUs(BENCH_LOOP_US);
+  }
+
+  uint32_t reports = 0, perFrame = 0, mostPerFrame = 0, frame = 0xFFFFFFFF;
+  uint32_t first = 0;
+  for (const TNativeReport *report; (report = nextKeyboardReport(&first)); first++) {
+    if (report->timeUs / 1000 != frame) {
+      frame = report->timeUs / 1000;
+      perFrame = 0;
+    }
+    perFrame++;
+    mostPerFrame = (perFrame > mostPerFrame) ? perFrame : mostPerFrame;
+    for (uint8_t i = 2; i < 8; i++) {
+      if ((report->data[i] >= KEY_F13) && (report->data[i] <= KEY_F20)) {
+        seen |= 1 << (report->data[i] - KEY_F13);
+      }
+      else if (report->data[i] == KEY_F22) {
+        seen |= comboKeys[0]; // the keys pressed within COMBO_TERM_MS went down as their combo
+      }
+    }
+    reports++;
+  }
+  printf("all keys within a frame: %u keyboard reports, at most %u per frame, %u/%u keys seen, longest loop pass %.2f ms\n",
+         reports, mostPerFrame, __builtin_popcount(seen), (unsigned)sizeof(benchPins), longestUs / 1000.0);
+  nativeClearReports();
+}
+
+// Spins the encoder fast and counts the mouse reports needed to deliver all detents. With the
+// linear curve every detent is one notch, so the notches missing are lost detents.
+static void benchEncoder(bool hiRes, enum TEncoderCurve curve)
+{
+  const int16_t detents = 600;
+  const uint32_t spinUs = 100000;
+  uint8_t multiplier[2] = {HID_REPORTID_MOUSE, (uint8_t)(hiRes ? 0x05 : 0x00)};
+  int32_t delivered = 0;
+  uint32_t lastUs = 0;
+  enum TEncoderCurve layerCurve = encoderLayerCurve[0][0];
+  encoderLayerCurve[0][0] = curve;
+
+  nativeSetReport(HID_REPORT_TYPE_FEATURE, multiplier, sizeof(multiplier));
+  for (int16_t i = 0; i < detents; i++) {
+    encoderTurn(4);
+    runFor(spinUs / detents);
+  }
+  uint32_t spinEndUs = micros();
+  runFor(50000);
+
+  uint32_t reports = 0;
+  for (uint32_t i = 0; i < nativeReportCount(); i++) {
+    const TNativeReport *report = nativeReport(i);
+    if (report->id == HID_REPORTID_MOUSE) {
+      delivered += (int16_t)(report->data[3] | (report->data[4] << 8)) + (int16_t)(report->data[5] | (report->data[6] << 8));
+      lastUs = report->timeUs;
+      reports++;
+    }
+  }
+  if (hiRes) {
+    delivered /= 120;
+  }
+  // only the linear curve sends a notch per detent, an accelerating one multiplies them
+  char lost[32] = "accelerated";
+  if (curve == ENCODER_CURVE_LINEAR) {
+    snprintf(lost, sizeof(lost), "%d lost", detents - delivered);
+  }
+  printf("encoder (%s, %s curve): %d detents in %u ms -> %d notches delivered (%s) in %u mouse reports, last one %.2f ms after the spin\n",
+         hiRes ? "high-resolution" : "notches", (curve == ENCODER_CURVE_LINEAR) ? "linear" : "scroll", detents, spinUs / 1000,
+         delivered, lost, reports, (lastUs > spinEndUs ? lastUs - spinEndUs : 0) / 1000.0);
+  encoderLayerCurve[0][0] = layerCurve;
+  nativeClearReports();
+}
+
+// Presses the keys of the first combo 10 ms apart, measures the time from the second press to its
+// report and checks that the keys themselves stay quiet
+static void benchCombo()
+{
+  uint8_t keys[2], count = 0;
+  for (uint8_t i = 0; (i < NUMBER_OF_KEYS) && (count < 2); i++) {
+    if (comboKeys[0] & ((uint32_t)1 << i)) {
+      keys[count++] = i;
+    }
+  }
+  uint32_t first = nativeReportCount();
+  nativeSetPin(benchPins[keys[0]], LOW);
+  runFor(10000);
+  uint32_t edgeUs = micros();
+  nativeSetPin(benchPins[keys[1]], LOW);
+  runFor(60000);
+  nativeSetPin(benchPins[keys[0]], HIGH);
+  nativeSetPin(benchPins[keys[1]], HIGH);
+  runFor(100000);
+
+  double comboMs = -1;
+  bool keysSent = false;
+  for (const TNativeReport *report; (report = nextKeyboardReport(&first)); first++) {
+    for (uint8_t i = 2; i < 8; i++) {
+      if ((report->data[i] == KEY_F22) && (comboMs < 0)) {
+        comboMs = (report->timeUs - edgeUs) / 1000.0;
+      }
+      keysSent |= (report->data[i] == KEY_F13 + keys[0]) || (report->data[i] == KEY_F13 + keys[1]);
+    }
+  }
+  printf("combo: last key press to report %.2f ms, keys of the combo sent alone: %s\n", comboMs, keysSent ? "yes" : "no");
+  nativeClearReports();
+}
+
+// Turns the encoder at increasing speeds and prints the wheel notches sent per detent turned
+static void benchAcceleration()
+{
+  static const uint16_t rates[] = {2, 6, 10, 16, 24, 40, 80}; // detents per second
+  uint8_t multiplier[2] = {HID_REPORTID_MOUSE, 0x05};
+  nativeSetReport(HID_REPORT_TYPE_FEATURE, multiplier, sizeof(multiplier));
+  printf("encoder acceleration, notches sent per detent:");
+  for (uint16_t rate : rates) {
+    const int16_t detents = 20;
+    int32_t delivered = 0;
+    runFor(500000);
+    nativeClearReports();
+    for (int16_t i = 0; i < detents; i++) {
+      encoderTurn(4);
+      runFor(1000000 / rate);
+    }
+    for (uint32_t i = 0; i < nativeReportCount(); i++) {
+      const TNativeReport *report = nativeReport(i);
+      if (report->id == HID_REPORTID_MOUSE) {
+        delivered += (int16_t)(report->data[3] | (report->data[4] << 8)) + (int16_t)(report->data[5] | (report->data[6] << 8));
+      }
+    }
+    printf(" %.2f at %u/s%s", delivered / 120.0 / detents, rate, (rate == rates[sizeof(rates) / sizeof(rates[0]) - 1]) ? "\n" : ",");
+  }
+  nativeClearReports();
+}
+
+// Contact bounce of a press or release: times of the pin edges, the first one goes to the new
+// level, the following ones alternate. Representative shapes, not recordings of these switches.
+typedef struct TBounceTraces {
+  const char *name;
+  uint16_t pressUs[10];
+  uint8_t pressEdges;
+  uint16_t releaseUs[10];
+  uint8_t releaseEdges;
+} TBounceTrace;
+
+static const TBounceTrace bounceTraces[] = {
+  {"clean", {0}, 1, {0}, 1},
+  {"short bounce", {0, 150, 400, 700, 900}, 5, {0, 300, 500, 1200, 1400}, 5},
+  {"long bounce", {0, 200, 600, 1100, 1500, 2600, 3000, 4800, 5000}, 9, {0, 500, 800, 2500, 3100, 4200, 4400}, 7},
+  {"40 us noise spike", {0, 40}, 2, {}, 0},
+};
+
+// Feeds the edges to debounce() for 40 ms in 25 us steps, returns the latency of the first change
+// of the debounced state or -1, counts the changes
+static int32_t bounce(const uint16_t *edgesUs, uint8_t edges, bool press, uint32_t *changes)
+{
+  const TKeyMask bit = 1;
+  int32_t latencyUs = -1;
+  bool before = debounce(press ? 0 : bit, millis()) & bit;
+  for (uint32_t t = 0; t < 40000; t += 25) {
+    uint8_t passed = 0;
+    while ((passed < edges) && (edgesUs[passed] <= t)) {
+      passed++;
+    }
+    bool level = (passed & 1) ? press : !press;
+    bool state = debounce(level ? bit : 0, millis()) & bit;
+    if (state != before) {
+      if (latencyUs < 0) {
+        latencyUs = t;
+      }
+      (*changes)++;
+      before = state;
+    }
+    nativeAdvanceUs(25);
+  }
+  return latencyUs;
+}
+
+// Press and release latency and spurious changes of the debounced state for both modes
+static void benchDebounce()
+{
+  for (uint8_t eager = 0; eager < 2; eager++) {
+    for (const TBounceTrace &trace : bounceTraces) {
+      uint32_t changes = 0;
+      debounceBegin(eager ? 1 : 0);
+      int32_t pressUs = bounce(trace.pressUs, trace.pressEdges, true, &changes);
+      int32_t releaseUs = trace.releaseEdges ? bounce(trace.releaseUs, trace.releaseEdges, false, &changes) : -1;
+      char press[16] = "-", release[16] = "-";
+      if (pressUs >= 0) {
+        snprintf(press, sizeof(press), "%.2f ms", pressUs / 1000.0);
+      }
+      if (releaseUs >= 0) {
+        snprintf(release, sizeof(release), "%.2f ms", releaseUs / 1000.0);
+      }
+      // an eager key takes a noise spike as a short press
+      printf("debounce %s, %s: press %s, release %s, %u state changes (%u expected)\n",
+             eager ? "eager" : "defer", trace.name, press, release, changes, ((eager) || (trace.releaseEdges)) ? 2 : 0);
+    }
+  }
+  debounceBegin();
+  runFor(100000);
+  nativeClearReports();
+}
+
+// Uploads a keymap over Raw HID while the second key is pressed every 160 ms, measures how long
+// the upload takes, what it costs in EEPROM writes and the key latency meanwhile
+static void benchConfig(uint8_t keyCode)
+{
+  const uint8_t upload[] = {
+    MACRO_KEY(keyCode), MACRO_TAP, MACRO_END,
+    MACRO_KEY(KEY_F14), MACRO_TAP, MACRO_END,
+    MACRO_KEY(KEY_F15), MACRO_TAP, MACRO_END,
+    MACRO_KEY(KEY_F16), MACRO_TAP, MACRO_END,
+    MACRO_KEY(KEY_F17), MACRO_TAP, MACRO_END,
+    MACRO_KEY(KEY_F18), MACRO_TAP, MACRO_END,
+    MACRO_MOD(KEY_LEFT_CTRL), MACRO_KEY(KEY_Z), MACRO_TAP, MACRO_KEY(KEY_A), MACRO_PRESS(50), MACRO_END,
+    MACRO_CONSUMER(MEDIA_VOLUME_MUTE), MACRO_TAP, MACRO_END,
+    // padding, so the upload takes a few pages
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  };
+  uint16_t crc = 0xFFFF;
+  for (uint16_t i = 0; i < sizeof(upload); i++) {
+    crc = _crc_ccitt_update(crc, upload[i]);
+  }
+
+  uint32_t writesBefore = nativeEepromWrites();
+  uint32_t startUs = micros();
+  uint32_t edgeUs = 0, worstUs = 0, measured = 0, requests = 0;
+  uint64_t sumUs = 0;
+  bool edgePending = false, waiting = false, done = false;
+  uint16_t offset = 0;
+  uint8_t status = CONFIG_OK;
+  uint32_t seen = nativeReportCount();
+  while (!done) {
+    uint32_t t = (micros() - startUs) % 160000;
+    if (t == 0) {
+      nativeSetPin(benchPins[1], LOW);
+      edgeUs = micros();
+      edgePending = true;
+    }
+    else if (t == 60000) {
+      nativeSetPin(benchPins[1], HIGH);
+    }
+    if (!waiting) {
+      TConfigPacket packet = {};
+      if (offset < sizeof(upload)) {
+        packet.command = CONFIG_WRITE;
+        packet.offset = offset;
+        packet.length = (sizeof(upload) - offset < CONFIG_PAGE_SIZE) ? sizeof(upload) - offset : CONFIG_PAGE_SIZE;
+        memcpy(packet.data, upload + offset, packet.length);
+      } else {
+        packet.command = CONFIG_COMMIT;
+        packet.length = sizeof(upload);
+        packet.crc = crc;
+      }
+      uint8_t report[1 + sizeof(packet)] = {HRAWHID_REPORT_ID};
+      memcpy(report + 1, &packet, sizeof(packet));
+      waiting = nativeSetReport(HID_REPORT_TYPE_OUTPUT, report, sizeof(report));
+      requests += waiting;
+    }
+    loop();
+    nativeAdvanceUs(BENCH_LOOP_US);
+    for (; seen < nativeReportCount(); seen++) {
+      const TNativeReport *report = nativeReport(seen);
+      if ((report->id == HID_REPORTID_KEYBOARD) && (edgePending)) {
+        uint32_t latencyUs = report->timeUs - edgeUs;
+        worstUs = (latencyUs > worstUs) ? latencyUs : worstUs;
+        sumUs += latencyUs;
+        measured++;
+        edgePending = false;
+      }
+      else if (report->id == HRAWHID_REPORT_ID) {
+        TConfigPacket reply;
+        memcpy(&reply, report->data, sizeof(reply));
+        waiting = false;
+        status = reply.status;
+        if ((reply.command == CONFIG_COMMIT) || (status != CONFIG_OK)) {
+          done = true;
+        } else {
+          offset += reply.length;
+        }
+      }
+    }
+  }
+  uint32_t uploadUs = micros() - startUs;
+  nativeSetPin(benchPins[1], HIGH);
+  runFor(100000);
+  nativeClearReports();
+
+  // the first key sends the uploaded key code now
+  uint32_t first = 0;
+  nativeSetPin(benchPins[0], LOW);
+  runFor(60000);
+  nativeSetPin(benchPins[0], HIGH);
+  runFor(100000);
+  const TNativeReport *report = nextKeyboardReport(&first);
+
+  printf("keymap upload: %u bytes in %u requests, %.0f ms, status %u, %u EEPROM bytes programmed, first key sends 0x%02X (0x%02X expected)\n",
+         (unsigned)sizeof(upload), requests, uploadUs / 1000.0, status, nativeEepromWrites() - writesBefore,
+         report ? report->data[2] : 0, keyCode);
+  printf("  key press to report meanwhile: avg %.2f ms, worst %.2f ms, %u presses\n",
+         measured ? sumUs / 1000.0 / measured : 0.0, worstUs / 1000.0, measured);
+  nativeClearReports();
+}
+
+// Sends one request over Raw HID and runs the firmware until the reply, false without one. A page
+// of changed bytes takes about 110 ms of EEPROM writes.
+static bool benchRequest(TConfigPacket *packet)
+{
+  uint8_t report[1 + sizeof(*packet)] = {HRAWHID_REPORT_ID};
+  memcpy(report + 1, packet, sizeof(*packet));
+  uint32_t seen = nativeReportCount();
+  if (!nativeSetReport(HID_REPORT_TYPE_OUTPUT, report, sizeof(report))) {
+    return false;
+  }
+  for (uint32_t t = 0; t < 500000; t += BENCH_LOOP_US) {
+    loop();
+    nativeAdvanceUs(BENCH_LOOP_US);
+    for (; seen < nativeReportCount(); seen++) {
+      if (nativeReport(seen)->id == HRAWHID_REPORT_ID) {
+        memcpy(packet, nativeReport(seen)->data, sizeof(*packet));
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Makes the keymap the one in use the way tools/keypadcfg load does
+static bool benchKeymap(const uint8_t *map, uint16_t size)
+{
+  TConfigPacket packet;
+  uint16_t crc = 0xFFFF;
+  for (uint16_t offset = 0; offset < size; offset += CONFIG_PAGE_SIZE) {
+    packet = {};
+    packet.command = CONFIG_WRITE;
+    packet.offset = offset;
+    packet.length = (size - offset < CONFIG_PAGE_SIZE) ? size - offset : CONFIG_PAGE_SIZE;
+    memcpy(packet.data, map + offset, packet.length);
+    if ((!benchRequest(&packet)) || (packet.status != CONFIG_OK)) {
+      return false;
+    }
+  }
+  for (uint16_t i = 0; i < size; i++) {
+    crc = _crc_ccitt_update(crc, map[i]);
+  }
+  packet = {};
+  packet.command = CONFIG_COMMIT;
+  packet.length = size;
+  packet.crc = crc;
+  return benchRequest(&packet) && (packet.status == CONFIG_OK);
+}
+
+// Key changes at ms after the start of a tap-hold scenario, pin index and level
+typedef struct TTapHoldSteps {
+  uint16_t ms;
+  uint8_t key;
+  uint8_t level;
+} TTapHoldStep;
+
+// Plays the changes and returns the keyboard reports of the scenario from index first on
+static void tapHoldScenario(const TTapHoldStep *steps, uint8_t count, uint32_t *first, uint32_t *startUs)
+{
+  runFor(100000);
+  *first = nativeReportCount();
+  *startUs = micros();
+  for (uint8_t i = 0; i < count; i++) {
+    runFor(steps[i].ms * 1000 - (micros() - *startUs));
+    nativeSetPin(benchPins[steps[i].key], steps[i].level);
+  }
+  runFor(300000);
+}
+
+// Time of the first keyboard report at or after first with the key code (and the modifiers if
+// not 0xFF) after startUs, -1 if none
+static double tapHoldReportMs(uint32_t first, uint32_t startUs, uint8_t modifiers, uint8_t code, uint32_t *index)
+{
+  for (const TNativeReport *report; (report = nextKeyboardReport(&first)); first++) {
+    bool hasCode = !code;
+    for (uint8_t i = 2; i < 8; i++) {
+      hasCode |= (code) && (report->data[i] == code);
+    }
+    if ((hasCode) && ((modifiers == 0xFF) || (report->data[0] == modifiers))) {
+      *index = first;
+      return (report->timeUs - startUs) / 1000.0;
+    }
+  }
+  return -1;
+}
+
+// Tap-hold key on the first key (F13 on tap, SHIFT on hold), F14 on the second. Prints when the
+// decided key reaches the host, measured from the pin edge that decides it (a release is taken
+// after DEBOUNCING_MS) or for the hold from the press.
+static void benchTapHold()
+{
+  const uint8_t upload[] = {
+    MACRO_HOLD_MOD(KEY_LEFT_SHIFT), MACRO_KEY(KEY_F13), MACRO_TAP, MACRO_END,
+    MACRO_KEY(KEY_F14), MACRO_TAP, MACRO_END,
+    MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END,
+    MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END,
+    MACRO_END, MACRO_END,
+  };
+  static const TTapHoldStep tap[] = {{0, 0, LOW}, {80, 0, HIGH}};
+  static const TTapHoldStep held[] = {{0, 0, LOW}, {400, 0, HIGH}};
+  static const TTapHoldStep permissive[] = {{0, 0, LOW}, {30, 1, LOW}, {60, 1, HIGH}, {150, 0, HIGH}};
+  static const TTapHoldStep roll[] = {{0, 0, LOW}, {30, 1, LOW}, {60, 0, HIGH}, {100, 1, HIGH}};
+  uint32_t first, startUs, index = 0;
+  if (!benchKeymap(upload, sizeof(upload))) {
+    printf("tap-hold: keymap not taken\n");
+    return;
+  }
+
+  tapHoldScenario(tap, 2, &first, &startUs);
+  double tapMs = tapHoldReportMs(first, startUs, 0, KEY_F13, &index) - 80;
+  tapHoldScenario(held, 2, &first, &startUs);
+  double holdMs = tapHoldReportMs(first, startUs, 0x02, 0, &index);
+  tapHoldScenario(permissive, 4, &first, &startUs);
+  double permissiveMs = tapHoldReportMs(first, startUs, 0x02, 0, &index) - 60;
+  bool shifted = tapHoldReportMs(first, startUs, 0x02, KEY_F14, &index) >= 0;
+  tapHoldScenario(roll, 4, &first, &startUs);
+  double rollMs = tapHoldReportMs(first, startUs, 0, KEY_F13, &index) - 60;
+  uint32_t f13 = index;
+  bool ordered = (tapHoldReportMs(first, startUs, 0, KEY_F14, &index) >= 0) && (index > f13) &&
+                 (tapHoldReportMs(first, startUs, 0x02, 0, &index) < 0);
+
+  printf("tap-hold edge to report (release debounce %u ms, term %u ms): tap %.2f ms, hold %.2f ms, permissive hold %.2f ms (F14 %s), roll %.2f ms (F13 before F14, no shift: %s)\n",
+         DEBOUNCING_MS, TAP_HOLD_TERM_MS, tapMs, holdMs, permissiveMs, shifted ? "shifted" : "not shifted", rollMs, ordered ? "yes" : "no");
+
+  TConfigPacket packet = {};
+  packet.command = CONFIG_FACTORY;
+  benchRequest(&packet);
+  runFor(100000);
+  nativeClearReports();
+}
+
+// Count of keyboard reports at or after first in which the key code goes down
+static uint32_t keyPresses(uint32_t first, uint8_t code)
+{
+  uint32_t presses = 0;
+  bool down = false;
+  for (const TNativeReport *report; (report = nextKeyboardReport(&first)); first++) {
+    bool now = memchr(report->data + 2, code, 6);
+    presses += now && !down;
+    down = now;
+  }
+  return presses;
+}
+
+// Detents with ENCODER_BINDINGS and the button events of the first encoder, each bound to a key,
+// then the host time of one sample of the encoder pins
+static void benchEncoderEvents()
+{
+  uint8_t upload[4 * NUMBER_OF_BINDINGS];
+  uint16_t size = 0;
+  for (uint8_t layer = 0; layer < NUMBER_OF_LAYERS; layer++) {
+    for (uint8_t i = 0; i < NUMBER_OF_BINDINGS; i++) {
+      if ((layer == 0) && (i >= ENCODER_KEY(0, 0)) && (i < ENCODER_KEY(0, ENCODER_EVENTS))) {
+        const uint8_t bound[] = {MACRO_KEY(KEY_F13 + i - ENCODER_KEY(0, 0)), MACRO_TAP};
+        memcpy(upload + size, bound, sizeof(bound));
+        size += sizeof(bound);
+      }
+      upload[size++] = MACRO_END;
+    }
+  }
+  if (!benchKeymap(upload, size)) {
+    printf("encoder events: keymap not taken\n");
+    return;
+  }
+  enum TEncoderAction action = encoderAction[0][0];
+  enum TEncoderCurve curve = encoderLayerCurve[0][0];
+  encoderAction[0][0] = ENCODER_BINDINGS;
+  encoderLayerCurve[0][0] = ENCODER_CURVE_LINEAR;
+
+  uint32_t first = nativeReportCount();
+  for (uint8_t i = 0; i < 5; i++) {
+    encoderTurn(ENCODER_STEPS_PER_NOTCH);
+    runFor(200000);
+  }
+  encoderTurn(-3 * ENCODER_STEPS_PER_NOTCH); // a flick, the detents are played one after another
+  runFor(200000);
+  static const uint16_t pressMs[][2] = {{0, 100}, {1000, 1100}, {1300, 1400}, {3000, 4500}}; // click, double click, hold
+  uint32_t startUs = micros();
+  for (const uint16_t *press : pressMs) {
+    runFor(press[0] * 1000 - (micros() - startUs));
+    nativeSetPin(encoderPin[2], LOW);
+    runFor(press[1] * 1000 - (micros() - startUs));
+    nativeSetPin(encoderPin[2], HIGH);
+  }
+  runFor(1000000);
+  printf("encoder events: %u/5 clockwise, %u/3 counterclockwise detents, %u/1 clicks, %u/1 double clicks, %u/1 holds\n",
+         keyPresses(first, KEY_F13 + ENCODER_CW), keyPresses(first, KEY_F13 + ENCODER_CCW), keyPresses(first, KEY_F13 + ENCODER_CLICK),
+         keyPresses(first, KEY_F13 + ENCODER_DOUBLE_CLICK), keyPresses(first, KEY_F13 + ENCODER_HOLD));
+  encoderAction[0][0] = action;
+  encoderLayerCurve[0][0] = curve;
+
+  auto start = std::chrono::steady_clock::now();
+  const uint32_t samples = 1000000;
+  for (uint32_t i = 0; i < samples; i++) {
+    rotaryInterrupt(ROTARY_CLK);
+  }
+  double hostS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("encoder sample of %u encoder(s): %.1f ns host time\n", NUMBER_OF_ENCODERS, hostS * 1e9 / samples);
+
+  TConfigPacket packet = {};
+  packet.command = CONFIG_FACTORY;
+  benchRequest(&packet);
+  runFor(100000);
+  nativeClearReports();
+}
+
+// Sum of the mouse reports from index first on
+typedef struct TMouseSums {
+  int32_t x, y, wheel;
+  uint32_t reports;
+  uint32_t mostPerFrame;
+  int8_t fastest, slowest; // largest and smallest x or y of a report in the last 200 ms
+} TMouseSum;
+
+static TMouseSum mouseSum(uint32_t first, uint32_t endUs)
+{
+  TMouseSum sum = {0, 0, 0, 0, 0, -128, 127};
+  uint32_t frame = 0xFFFFFFFF, inFrame = 0;
+  for (uint32_t i = first; i < nativeReportCount(); i++) {
+    const TNativeReport *report = nativeReport(i);
+    if (report->id != HID_REPORTID_MOUSE) {
+      continue;
+    }
+    int8_t x = report->data[1], y = report->data[2];
+    sum.x += x;
+    sum.y += y;
+    sum.wheel += (int16_t)(report->data[3] | (report->data[4] << 8));
+    sum.reports++;
+    inFrame = (report->timeUs / 1000 == frame) ? inFrame + 1 : 1;
+    frame = report->timeUs / 1000;
+    sum.mostPerFrame = (inFrame > sum.mostPerFrame) ? inFrame : sum.mostPerFrame;
+    if ((report->timeUs + 200000 > endUs) && (report->timeUs < endUs)) {
+      int8_t step = (abs(x) > abs(y)) ? abs(x) : abs(y);
+      sum.fastest = (step > sum.fastest) ? step : sum.fastest;
+      sum.slowest = (step < sum.slowest) ? step : sum.slowest;
+    }
+  }
+  return sum;
+}
+
+// Holds the keys (bits of pin indexes) for ms and returns the mouse reports of the press
+static TMouseSum mouseKeysHold(uint8_t keys, uint32_t ms)
+{
+  runFor(100000);
+  uint32_t first = nativeReportCount();
+  for (uint8_t i = 0; i < 8; i++) {
+    if (keys & (1 << i)) {
+      nativeSetPin(benchPins[i], LOW);
+    }
+  }
+  runFor(ms * 1000);
+  uint32_t endUs = micros();
+  for (uint8_t i = 0; i < 8; i++) {
+    nativeSetPin(benchPins[i], HIGH);
+  }
+  runFor(100000);
+  return mouseSum(first, endUs);
+}
+
+// Mouse keys on the first keys: right, down and wheel down. Prints the distance of a tap and of
+// held keys, the reports per frame and how even the steps are at full speed.
+static void benchMouseKeys()
+{
+  static const uint8_t directions[] = {MOUSE_KEY_RIGHT, MOUSE_KEY_DOWN, MOUSE_KEY_WHEEL_DOWN};
+  uint8_t upload[2 * NUMBER_OF_BINDINGS + sizeof(directions) * 2];
+  uint16_t size = 0;
+  for (uint8_t layer = 0; layer < NUMBER_OF_LAYERS; layer++) {
+    for (uint8_t i = 0; i < NUMBER_OF_BINDINGS; i++) {
+      if ((layer == 0) && (i < sizeof(directions))) {
+        const uint8_t bound[] = {MACRO_MOUSE_KEYS(directions[i])};
+        memcpy(upload + size, bound, sizeof(bound));
+        size += sizeof(bound);
+      }
+      upload[size++] = MACRO_END;
+    }
+  }
+  uint8_t multiplier[2] = {HID_REPORTID_MOUSE, 0x05};
+  nativeSetReport(HID_REPORT_TYPE_FEATURE, multiplier, sizeof(multiplier));
+  if (!benchKeymap(upload, size)) {
+    printf("mouse keys: keymap not taken\n");
+    return;
+  }
+
+  TMouseSum tap = mouseKeysHold(0x01, 30);
+  TMouseSum held = mouseKeysHold(0x01, 1000);
+  TMouseSum diagonal = mouseKeysHold(0x03, 1000);
+  TMouseSum wheel = mouseKeysHold(0x04, 500);
+  printf("mouse keys: tap of 30 ms %d px, held 1 s %d px in %u reports (at most %u per frame, %d-%d px per frame at full speed), "
+         "diagonal 1 s %d x %d px (%.0f px long), wheel 0.5 s %.1f notches down\n",
+         tap.x, held.x, held.reports, held.mostPerFrame, held.slowest, held.fastest, diagonal.x, diagonal.y,
+         sqrt((double)diagonal.x * diagonal.x + (double)diagonal.y * diagonal.y), -wheel.wheel / 120.0);
+
+  TConfigPacket packet = {};
+  packet.command = CONFIG_FACTORY;
+  benchRequest(&packet);
+  runFor(100000);
+  nativeClearReports();
+}
+
+// Holds the first key (F13) for 2 s and returns the times of its presses in ms from the pin edge
+static uint8_t repeatPresses(uint16_t *pressMs, uint8_t size)
+{
+  runFor(100000);
+  uint32_t first = nativeReportCount();
+  uint32_t startUs = micros();
+  nativeSetPin(benchPins[0], LOW);
+  runFor(2000000);
+  nativeSetPin(benchPins[0], HIGH);
+  runFor(100000);
+  uint8_t presses = 0;
+  bool down = false;
+  for (const TNativeReport *report; (report = nextKeyboardReport(&first)); first++) {
+    bool now = memchr(report->data + 2, KEY_F13, 6);
+    if ((now) && (!down) && (presses < size)) {
+      pressMs[presses++] = (report->timeUs - startUs) / 1000;
+    }
+    down = now;
+  }
+  nativeClearReports();
+  return presses;
+}
+
+// Repeats of a held key with the default and the accelerating profile, then the host time of
+// checkKeys() with no key and with all keys held, when no repeat is due
+static void benchRepeat()
+{
+  uint16_t pressMs[64];
+  uint8_t presses = repeatPresses(pressMs, 64);
+  printf("repeat (default): %u presses in 2 s, first repeat after %d ms, then every %d ms\n", presses,
+         (presses > 1) ? pressMs[1] - pressMs[0] : -1, (presses > 2) ? pressMs[2] - pressMs[1] : -1);
+  enum TKeyRepeatProfile profile = keyRepeat[0];
+  keyRepeat[0] = KEY_REPEAT_ACCELERATE;
+  presses = repeatPresses(pressMs, 64);
+  printf("repeat (accelerate): %u presses in 2 s, intervals", presses);
+  for (uint8_t i = 1; (i < presses) && (i < 10); i++) {
+    printf(" %u", pressMs[i] - pressMs[i - 1]);
+  }
+  printf("%s ms\n", (presses > 10) ? " ..." : "");
+  keyRepeat[0] = profile;
+
+  const uint32_t calls = 1000000;
+  double hostNs[2];
+  for (uint8_t held = 0; held < 2; held++) {
+    for (uint8_t pin : benchPins) {
+      nativeSetPin(pin, held ? LOW : HIGH);
+    }
+    runFor(100000);
+    uint32_t now = millis();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < calls; i++) {
+      checkKeys(now);
+    }
+    hostNs[held] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e9 / calls;
+  }
+  for (uint8_t pin : benchPins) {
+    nativeSetPin(pin, HIGH);
+  }
+  runFor(1000000);
+  nativeClearReports();
+  printf("checkKeys() with no repeat due: %.1f ns host time with no key, %.1f ns with all %u keys held\n", hostNs[0],
+         hostNs[1], (unsigned)sizeof(benchPins));
+}
+
+// Types a text the way tools/keypadcfg type does, the next request goes out with the reply to the
+// last one. Prints the rate from the first request to the last release and whether the keyboard
+// reports give back the text.
+static void benchStream()
+{
+  static const char text[] =
+    "The bookkeeper's committee agreed: 1000 Mississippi llamas -- aaa, AAA, aAaA!\n"
+    "#include <stdio.h> int main() { return 0; }\ttabs\tand  double  spaces...";
+  const size_t count = sizeof(text) - 1;
+  uint8_t keys[2 * sizeof(text)];
+  for (size_t i = 0; i < count; i++) {
+    configTypeKey(text[i], &keys[2 * i], &keys[2 * i + 1]);
+  }
+
+  uint32_t first = nativeReportCount();
+  uint32_t startUs = micros();
+  size_t sent = 0;
+  uint16_t credit = 0, pending = 0, requests = 0;
+  do {
+    TConfigPacket packet = {};
+    packet.command = CONFIG_TYPE;
+    size_t n = count - sent;
+    n = (n < credit) ? n : credit;
+    n = (n < CONFIG_PAGE_SIZE / 2) ? n : CONFIG_PAGE_SIZE / 2;
+    packet.length = 2 * n;
+    memcpy(packet.data, keys + 2 * sent, packet.length);
+    if ((!benchRequest(&packet)) || (packet.status != CONFIG_OK)) {
+      printf("stream: request refused\n");
+      return;
+    }
+    requests++;
+    sent += n;
+    credit = packet.offset;
+    pending = packet.length;
+  } while ((sent < count) || (pending));
+  uint32_t elapsedUs = micros() - startUs;
+
+  // a character is a key code new in its report, with the modifiers of that report
+  char typed[sizeof(text)] = {0};
+  size_t typedCount = 0;
+  uint8_t previous[6] = {0};
+  uint32_t lastUs = startUs;
+  for (const TNativeReport *report; (report = nextKeyboardReport(&first)); first++) {
+    for (uint8_t i = 2; i < 8; i++) {
+      uint8_t code = report->data[i];
+      if ((!code) || (memchr(previous, code, sizeof(previous)))) {
+        continue;
+      }
+      for (int c = 1; (c < 128) && (typedCount < count); c++) {
+        uint8_t m, k;
+        if ((configTypeKey((char)c, &m, &k)) && (k == code) && (m == report->data[0])) {
+          typed[typedCount++] = (char)c;
+          break;
+        }
+      }
+    }
+    memcpy(previous, report->data + 2, sizeof(previous));
+    lastUs = report->timeUs;
+  }
+  printf("stream: %u characters in %.1f ms, %.0f characters/s (%.0f until the last report), %u requests, typed %s\n",
+         (unsigned)count, elapsedUs / 1000.0, count * 1e6 / elapsedUs, count * 1e6 / (lastUs - startUs), requests,
+         (typedCount == count) && (memcmp(typed, text, count) == 0) ? "correctly" : "WRONG");
+  runFor(100000);
+  nativeClearReports();
+}
+
+#ifdef STATS
+// Presses keys and spins the encoder, then reads the statistics the way tools/keypadcfg does
+static void benchStats()
+{
+  static const char *const names[STATS_HISTOGRAMS] = {"loop period", "checkKeys()", "encoder pin ISR", "key to report", "USB send"};
+  TConfigPacket packet = {};
+  packet.command = CONFIG_STATS_CLEAR;
+  benchRequest(&packet);
+  for (uint8_t i = 0; i < 16; i++) {
+    nativeSetPin(benchPins[i % sizeof(benchPins)], LOW);
+    runFor(60000);
+    nativeSetPin(benchPins[i % sizeof(benchPins)], HIGH);
+    encoderTurn(8);
+    runFor(60000);
+  }
+
+  TConfigStats stats;
+  for (uint16_t offset = 0; offset < sizeof(stats); offset += CONFIG_PAGE_SIZE) {
+    packet = {};
+    packet.command = CONFIG_STATS;
+    packet.offset = offset;
+    packet.length = (sizeof(stats) - offset < CONFIG_PAGE_SIZE) ? sizeof(stats) - offset : CONFIG_PAGE_SIZE;
+    if ((!benchRequest(&packet)) || (packet.status != CONFIG_OK)) {
+      printf("stats: no reply\n");
+      return;
+    }
+    memcpy((uint8_t *)&stats + offset, packet.data, packet.length);
+  }
+  double cyclesPerUs = stats.cpuHz / 1e6;
+  for (uint8_t i = 0; i < STATS_HISTOGRAMS; i++) {
+    const TConfigHistogram *h = &stats.histogram[i];
+    printf("stats %s: %u samples, min %.1f us, avg %.1f us, max %.1f us\n", names[i], h->count, h->min / cyclesPerUs,
+           h->count ? h->sum / cyclesPerUs / h->count : 0.0, h->max / cyclesPerUs);
+  }
+  printf("stats counters: %u encoder steps dropped, %u coalesced, %u reports merged, %u dropped, over %u ms\n",
+         stats.counter[STATS_ENCODER_DROPPED], stats.counter[STATS_ENCODER_COALESCED],
+         stats.counter[STATS_REPORTS_MERGED], stats.counter[STATS_REPORTS_DROPPED], stats.uptimeMs);
+  nativeClearReports();
+}
+#endif
+
+// Leaves the pad untouched and counts loop passes that ended in sleep
+static void benchIdle()
+{
+  runFor(2000000);
+  uint32_t sleepsBefore = nativeSleepCount();
+  uint32_t passes = runFor(1000000);
+  printf("idle: %.1f%% of loop passes went to sleep\n", 100.0 * (nativeSleepCount() - sleepsBefore) / passes);
+}
+
+int main()
+{
+  nativeReset();
+  setup();
+  runFor(10000);
+  nativeClearReports();
+
+  benchDebounce();
+  benchScan();
+  benchMatrix();
+  benchExpander();
+  benchBurst();
+  benchCombo();
+  benchEncoder(false, ENCODER_CURVE_LINEAR);
+  benchEncoder(true, ENCODER_CURVE_LINEAR);
+  benchEncoder(true, ENCODER_CURVE_SCROLL);
+  benchAcceleration();
+  benchIdle();
+  // new keymap, the same one to the other slot, the same one back to the first slot
+  benchConfig(KEY_F21);
+  benchConfig(KEY_F21);
+  benchConfig(KEY_F21);
+  benchTapHold();
+  benchEncoderEvents();
+  benchMouseKeys();
+  benchRepeat();
+  benchStream();
+#ifdef STATS
+  benchStats();
+#endif
+  return 0;
+}
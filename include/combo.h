@@ -0,0 +1,57 @@
+#ifndef COMBO_H
+#define COMBO_H
+
+#include "keyscan.h"
+
+// Key combinations (comboKeys[] in keypad.h). A key that is part of some combo is held back when
+// pressed until it is clear whether a combo forms: all keys of a combo down within COMBO_TERM_MS
+// make the combo key (bit NUMBER_OF_KEYS + combo) go down instead, it goes up with the first
+// of its keys released. The held back keys pass through when the term runs out, one of them is
+// released, a key of no combo is pressed or the pressed keys are part of no combo together. Keys
+// of no combo always pass through right away. Matching uses masks precomputed from comboKeys[],
+// a scan costs a few mask operations plus a loop over the combos only while keys are held back.
+
+// Keys that are part of some combo
+constexpr TKeyMask comboMemberKeys() {
+  TKeyMask mask = 0;
+  for (uint8_t i = 0; i < NUMBER_OF_COMBOS; i++) {
+    mask |= comboKeys[i];
+  }
+  return mask;
+}
+
+// Combos every key is part of, bit per combo
+typedef struct TComboTables {
+  uint32_t ofKey[NUMBER_OF_KEYS];
+} TComboTable;
+
+constexpr TComboTable comboTable() {
+  TComboTable table = {};
+  for (uint8_t i = 0; i < NUMBER_OF_COMBOS; i++) {
+    for (uint8_t key = 0; key < NUMBER_OF_KEYS; key++) {
+      if (comboKeys[i] & ((uint64_t)1 << key)) {
+        table.ofKey[key] |= (uint32_t)1 << i;
+      }
+    }
+  }
+  return table;
+}
+
+constexpr bool comboKeysValid() {
+  for (uint8_t i = 0; i < NUMBER_OF_COMBOS; i++) {
+    uint64_t keys = comboKeys[i];
+    if (((NUMBER_OF_KEYS < 64) && (keys >> (NUMBER_OF_KEYS % 64))) || (!(keys & (keys - 1)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(NUMBER_OF_COMBOS <= 32, "combos are a bit mask of 32 bits");
+static_assert(comboKeysValid(), "comboKeys[] has a combo of less than 2 keys or a key beyond NUMBER_OF_KEYS");
+
+void comboBegin();
+TKeyMask combo(TKeyMask pressed, uint32_t now); // debounced keys -> keys and combos
+bool comboBusy();                              // keys are held back
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "keypad.h"
+#include "configprotocol.h"
+
+#define CONFIG_EEPROM_HEADER 0 // EEPROM address of the header telling which slot holds the keymap
+#define CONFIG_EEPROM_SLOTS 16 // EEPROM address of the first of two keymap slots, KEYMAP_MAX_SIZE bytes each
+
+// Keymap configuration over Raw HID (protocol in configprotocol.h, host side in tools/). A new
+// keymap goes to the slot not in use and the header is switched to it on commit, so the keymap in
+// use survives a failed or interrupted upload and the two slots share the wear. Only bytes that
+// differ are programmed. EEPROM is written in the background, one byte per configRun() call, and
+// the keymap cache is replaced only while no sequence plays, so keys are served during uploads.
+
+void configBegin();         // use the keymap committed to EEPROM if there is a valid one
+void configRun(bool busy);  // serve Raw HID requests, busy: keys are held or a sequence plays, keep the keymap
+bool configBusy();          // a request is being served
+
+#endif
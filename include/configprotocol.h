@@ -0,0 +1,147 @@
+#ifndef CONFIGPROTOCOL_H
+#define CONFIGPROTOCOL_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Keymap configuration over Raw HID, shared by the firmware and tools/keypadcfg.c. Every request
+// is one output report with a TConfigPacket, the device answers it with one input report holding
+// the same packet with status and the result filled in. Multi-byte fields are LSB first.
+//
+// The new keymap is written to a staging EEPROM slot in pages and activated by CONFIG_COMMIT,
+// the keymap in use is not touched until then:
+//   CONFIG_WRITE offset 0, 32, 64 ... -> CONFIG_CHECKSUM (optional) -> CONFIG_COMMIT
+//
+// CONFIG_TYPE streams text to be typed. Its reply carries the credit, the number of keys the
+// device takes next, so the host sends at most that many and keeps the device's buffer filled
+// without overrunning it. A CONFIG_TYPE without data asks for the credit only.
+
+#define CONFIG_VERSION 2
+#define CONFIG_PAGE_SIZE 32 // data bytes of one packet
+
+#define CONFIG_INFO 0x01     // -> length: keymap size, crc: keymap CRC, data: TConfigInfo
+#define CONFIG_READ 0x02     // offset, length -> data of the keymap in use
+#define CONFIG_WRITE 0x03    // offset, length, data -> written to the staging slot
+#define CONFIG_CHECKSUM 0x04 // length -> crc of the first length bytes of the staging slot
+#define CONFIG_COMMIT 0x05   // length, crc of the staging slot -> the staged keymap is used and kept
+#define CONFIG_FACTORY 0x06  // -> the keymap built into the firmware is used again
+#define CONFIG_STATS 0x07    // offset, length -> data of TConfigStats, firmware built with STATS only
+#define CONFIG_STATS_CLEAR 0x08 // -> statistics start again
+#define CONFIG_TYPE 0x09     // length, data: (modifier bits, key code) pairs -> offset: credit, length: keys not typed yet
+
+#define CONFIG_OK 0x00
+#define CONFIG_ERROR_COMMAND 0x01  // unknown command
+#define CONFIG_ERROR_RANGE 0x02    // offset or length out of the keymap, more keys than the credit
+#define CONFIG_ERROR_CHECKSUM 0x03 // staged data do not match the crc
+#define CONFIG_ERROR_KEYMAP 0x04   // staged data are not a binding for every key
+
+#define CONFIG_SOURCE_FIRMWARE 0 // keymap[] built into the firmware
+#define CONFIG_SOURCE_EEPROM 1   // keymap committed over Raw HID
+
+typedef struct __attribute__((packed)) TConfigPackets {
+  uint8_t command;
+  uint8_t status;
+  uint16_t offset;
+  uint16_t length;
+  uint16_t crc; // CRC-16/CCITT as _crc_ccitt_update() of avr-libc, initial value 0xFFFF
+  uint8_t data[CONFIG_PAGE_SIZE];
+} TConfigPacket;
+
+typedef struct __attribute__((packed)) TConfigInfos {
+  uint8_t version;
+  uint8_t source;
+  uint8_t numberOfKeys;
+  uint8_t pageSize;
+  uint16_t maxSize; // bytes available for the keymap
+  uint8_t numberOfLayers;
+  uint8_t bindingsPerLayer; // keys, combos and the encoder events
+} TConfigInfo;
+
+// Modifier bits and key code of a printable ASCII character, newline or tab on the US layout for
+// CONFIG_TYPE, 0 if there is no key for it
+static inline int configTypeKey(char c, uint8_t *modifiers, uint8_t *code) {
+  static const char symbols[] = "-=[]\\;'`,./";
+  static const char shifted[] = "_+{}|:\"~<>?";
+  static const char digits[] = "!@#$%^&*()";
+  static const uint8_t symbolCodes[] = {0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38};
+  const char *found;
+  *modifiers = 0;
+  if ((c >= 'a') && (c <= 'z')) {
+    *code = 0x04 + (c - 'a');
+  }
+  else if ((c >= 'A') && (c <= 'Z')) {
+    *modifiers = 0x02; // left shift
+    *code = 0x04 + (c - 'A');
+  }
+  else if ((c >= '1') && (c <= '9')) {
+    *code = 0x1E + (c - '1');
+  }
+  else if (c == '0') {
+    *code = 0x27;
+  }
+  else if (c == '\n') {
+    *code = 0x28;
+  }
+  else if (c == '\t') {
+    *code = 0x2B;
+  }
+  else if (c == ' ') {
+    *code = 0x2C;
+  }
+  else if ((c) && ((found = strchr(symbols, c)))) {
+    *code = symbolCodes[found - symbols];
+  }
+  else if ((c) && ((found = strchr(shifted, c)))) {
+    *modifiers = 0x02;
+    *code = symbolCodes[found - shifted];
+  }
+  else if ((c) && ((found = strchr(digits, c)))) {
+    *modifiers = 0x02;
+    *code = 0x1E + (found - digits);
+  }
+  else {
+    return 0;
+  }
+  return 1;
+}
+
+// Statistics of the firmware built with STATS, durations in CPU cycles. Bucket 0 of a histogram
+// counts samples below 2^STATS_BUCKET_SHIFT cycles, bucket b samples from 2^(b + STATS_BUCKET_SHIFT - 1)
+// to twice that, the last bucket everything longer. Buckets stop at 0xFFFF.
+
+#define STATS_BUCKETS 16
+#define STATS_BUCKET_SHIFT 5
+
+enum TStatsHistogram {
+  STATS_LOOP,    // start of loop() to the start of the next pass, sleep included
+  STATS_SCAN,    // checkKeys()
+  STATS_ISR,     // encoder pin interrupt
+  STATS_LATENCY, // debounced key change to its report handed to the USB
+  STATS_SEND,    // handing one report to the USB
+  STATS_HISTOGRAMS
+};
+
+enum TStatsCounter {
+  STATS_ENCODER_DROPPED,   // encoder steps lost to the wheel, pan and volume limits
+  STATS_ENCODER_COALESCED, // encoder steps sent in one report with earlier steps
+  STATS_REPORTS_MERGED,    // reports replaced by the next one while queued
+  STATS_REPORTS_DROPPED,   // reports lost to a full queue or a host that stopped polling
+  STATS_COUNTERS
+};
+
+typedef struct __attribute__((packed)) TConfigHistograms {
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t sum;
+  uint16_t bucket[STATS_BUCKETS];
+} TConfigHistogram;
+
+typedef struct __attribute__((packed)) TConfigStatss {
+  uint32_t cpuHz;    // cycles per second
+  uint32_t uptimeMs; // since the start or CONFIG_STATS_CLEAR
+  TConfigHistogram histogram[STATS_HISTOGRAMS];
+  uint32_t counter[STATS_COUNTERS];
+} TConfigStats;
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include "keyscan.h"
+
+// Debounces all keys at once. Every key has a counter of milliseconds its pin differs from the
+// debounced state, kept as vertical counters: bit n of all counters is one TKeyMask, so a sample
+// updates all keys with a few word operations. A state change is accepted when the counter
+// reaches DEBOUNCING_MS, any sample that agrees with the state resets the counter.
+//
+// Keys in DEBOUNCE_EAGER mode take the press at the first sample, bounces after it only reset the
+// release counter. Their release is deferred as in DEBOUNCE_DEFER mode, which also makes sure the
+// contact settled before the next press is taken right away. A noise spike on an eager key reads
+// as a short press, use DEBOUNCE_DEFER for keys on long or noisy wires.
+
+// Counter bits needed to count to DEBOUNCING_MS
+constexpr uint8_t debounceBits(uint16_t ms) {
+  uint8_t bits = 1;
+  while ((ms >> bits) != 0) {
+    bits++;
+  }
+  return bits;
+}
+
+#define DEBOUNCE_BITS debounceBits(DEBOUNCING_MS)
+
+// Keys set to DEBOUNCE_EAGER in keyDebounce[]
+constexpr TKeyMask keyDebounceEager() {
+  TKeyMask mask = 0;
+  for (uint8_t i = 0; i < NUMBER_OF_KEYS; i++) {
+    if (keyDebounce[i] == DEBOUNCE_EAGER) {
+      mask |= (TKeyMask)1 << i;
+    }
+  }
+  return mask;
+}
+
+void debounceBegin(TKeyMask eager = keyDebounceEager());
+TKeyMask debounce(TKeyMask raw, uint32_t now); // debounced state from the scanned one, bit i set when key i is pressed
+bool debounceBusy();                           // some key waits for its change to be accepted
+
+#endif
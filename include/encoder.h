@@ -0,0 +1,51 @@
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include "keypad.h"
+
+#define ENCODER_MAX_VOLUME_STEPS 20 // pending volume steps above this are dropped, so the volume does not keep moving long after the knob stopped
+#define ENCODER_MAX_DETENTS 20      // pending detents of ENCODER_BINDINGS above this are dropped, the same way
+#define ENCODER_CURVE_POINTS 16     // gains of an acceleration curve
+#define ENCODER_CURVE_RATE_STEP 4   // detents per second from one point of a curve to the next
+#define ENCODER_CURVE_ONE 16        // gain 1.0, gains have 4 fractional bits
+#define ENCODER_RATE_RESET_MS 150   // after a pause this long or a change of direction the rotation starts at the slow end of the curve again
+
+// What the rotation of an encoder does
+enum TEncoderAction {
+  ENCODER_WHEEL,   // vertical mouse wheel
+  ENCODER_PAN,     // horizontal mouse wheel
+  ENCODER_VOLUME,  // consumer volume up / down
+  ENCODER_BINDINGS // every detent plays the ENCODER_CW or ENCODER_CCW binding of the encoder
+};
+
+// Acceleration curves, the gain of point i applies from i * ENCODER_CURVE_RATE_STEP detents per
+// second up. The curves are defined with the keymap in main.cpp.
+enum TEncoderCurve {
+  ENCODER_CURVE_LINEAR, // 1:1 at any speed
+  ENCODER_CURVE_SCROLL, // wheel and pan, long documents in a few turns
+  ENCODER_CURVE_VOLUME, // volume, gentle so the level stays under control
+  ENCODER_CURVES
+};
+
+extern const uint8_t encoderCurve[ENCODER_CURVES][ENCODER_CURVE_POINTS] PROGMEM;
+
+// Rotation is counted in quadrature steps (ENCODER_STEPS_PER_NOTCH per detent), accumulated and
+// queued by encoderFlush(). Mouse wheel and pan go to the mouse queue, which sums the deltas
+// until the host polls, so one high-resolution report carries everything turned within a frame
+// and every step moves the view when the host enabled the resolution multiplier (whole notches
+// otherwise). Volume is sent per detent as one press report and one release report, the next
+// one is queued when the host got the previous one. Detents of ENCODER_BINDINGS wait until the
+// loop plays them, one per pass and encoder.
+//
+// Every encoder measures its rotation speed in detents per second from the times whole detents
+// complete, which picks the gain of the curve that multiplies its steps. Fractions of a step are
+// carried to the next call, so a curve with gain ENCODER_CURVE_ONE at slow speeds is exactly 1:1
+// there. The wheel, pan and volume of all encoders add up.
+
+void encoderAdd(uint8_t encoder, enum TEncoderAction action, enum TEncoderCurve curve, int16_t steps, uint32_t now);
+int8_t encoderDetent(uint8_t encoder);  // direction of the next pending detent of ENCODER_BINDINGS, 0 if none
+void encoderDetentDone(uint8_t encoder); // the detent was played
+void encoderFlush();
+bool encoderBusy();
+
+#endif
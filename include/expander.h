@@ -0,0 +1,55 @@
+#ifndef EXPANDER_H
+#define EXPANDER_H
+
+#include "keyscan.h"
+
+#define EXPANDER_I2C_HZ 400000          // TWI clock, the fastest the ATmega32U4 runs, the MCP23017 takes up to 1.7 MHz
+#define EXPANDER_MCP23017_ADDRESS 0x20  // I2C address of the first MCP23017, the next chips follow
+
+// Bus pins of the ATmega32U4, fixed by the TWI and SPI units
+#define EXPANDER_SDA_PIN 2
+#define EXPANDER_SCL_PIN 3
+#define EXPANDER_MISO_PIN 14
+#define EXPANDER_SCK_PIN 15
+#define EXPANDER_SS_PIN 17 // an output, as an input low it would turn the SPI into a slave
+
+// Keys on MCP23017 (I2C) or 74HC165 (SPI shift register) expanders. expanderStart() sends the
+// first bus event and the TWI or SPI interrupt drives the rest of the read, chip after chip, so the
+// loop goes on with the keys of the last read while the next one runs. keyScan() takes the keys
+// of the last finished read and starts the next one, the expander keys are one read (about 120 us
+// per MCP23017 at 400 kHz, 1 us per 74HC165 at 8 MHz) older than the keys on the MCU pins.
+//
+// The MCP23017s are set up by the first read: pull-ups on and the inputs inverted, so a pressed
+// key reads 1. Every read is then one transfer per chip: GPIOA register, repeated start, GPIOA and
+// GPIOB. A chip that does not answer reads as no key pressed and is set up again once it answers.
+// SDA and SCL need external pull-ups, the internal ones are too weak for 400 kHz. The 74HC165
+// chain takes its inputs while its parallel load pin is low, between reads, and shifts them out
+// on SPI mode 0. Its inputs need pull-ups, a pressed key pulls its input low.
+
+// Chips of a type whose keys fit the 64 bits of expanderKeys()
+constexpr uint8_t expanderMaxChips(uint8_t type) {
+  return (type == EXPANDER_MCP23017) ? 4 : (type == EXPANDER_74HC165) ? 8 : 0;
+}
+
+constexpr bool expanderChipsFit(uint8_t type, uint8_t chips) {
+  return chips <= expanderMaxChips(type);
+}
+
+void expanderBegin(uint8_t type, uint8_t chips); // EXPANDER_* of keypad.h, EXPANDER_NONE stops the bus, chips up to expanderMaxChips(type)
+void expanderStart();    // starts a read of all chips unless one runs
+uint64_t expanderKeys(); // keys of the last finished read, bit 16 * chip + input (MCP23017, GPIOA first) or 8 * chip + input (74HC165)
+uint16_t expanderReads(); // finished reads, wraps around
+
+#if KEY_EXPANDER == EXPANDER_MCP23017
+constexpr uint8_t expanderPin[] = {EXPANDER_SDA_PIN, EXPANDER_SCL_PIN};
+#elif KEY_EXPANDER == EXPANDER_74HC165
+constexpr uint8_t expanderPin[] = {EXPANDER_MISO_PIN, EXPANDER_SCK_PIN, EXPANDER_SS_PIN, EXPANDER_LOAD_PIN};
+#endif
+#if KEY_EXPANDER != EXPANDER_NONE
+static_assert(pinsDistinct(expanderPin, sizeof(expanderPin)) && pinsFreeOfKeys(expanderPin, sizeof(expanderPin)),
+              "the expander bus pins are used by keys or the encoder");
+#endif
+static_assert(expanderChipsFit(KEY_EXPANDER, EXPANDER_CHIPS), "up to 4 MCP23017 or 8 74HC165 expanders");
+static_assert(NUMBER_OF_LOCAL_KEYS + NUMBER_OF_EXPANDER_KEYS <= 64, "the expander keys do not fit the key mask next to the keys on the MCU pins");
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef HIDQUEUE_H
+#define HIDQUEUE_H
+
+#include "keypad.h"
+
+#define HID_QUEUE_SIZE 4         // reports waiting per interface, power of 2
+#define HID_QUEUE_REPORT_SIZE 8  // bytes of the biggest report
+#define HID_QUEUE_TIMEOUT_MS 250 // waiting reports are dropped when the host takes none for this long (suspended, unplugged), as USB_Send() does
+
+// Every report goes through a ring of its interface and hidQueueRun() hands them to the USB at
+// most once per USB frame, only when the endpoint bank is free, so the scan path never waits for
+// the host. A report that only continues the changes of the last queued one replaces it, mouse
+// reports with the same buttons are summed as long as the sum fits into one report. A full ring
+// takes the new key state in place of its last report, so the host still ends up in the right
+// state. A full mouse ring refuses a report it cannot sum, the caller keeps the buttons and the
+// motion and pushes them again in a later pass. The rings have one producer (loop) and one
+// consumer (hidQueueRun()) and the producer never touches the report at the head, so the consumer
+// could also run from the USB start of frame interrupt.
+
+enum THidQueue {
+  HID_QUEUE_KEYBOARD, // modifiers, reserved, 6 key codes
+  HID_QUEUE_CONSUMER, // 4 key codes of 2 bytes (LSB first)
+  HID_QUEUE_SYSTEM,   // 1 key code
+  HID_QUEUE_MOUSE,    // THidQueueMouse
+  HID_QUEUE_COUNT
+};
+
+typedef struct THidQueueMouses {
+  uint8_t buttons;
+  int8_t x;
+  int8_t y;
+  int16_t wheel; // in 1/HMOUSE_HIRES_RESOLUTION of a notch
+  int16_t pan;
+} THidQueueMouse;
+
+bool hidQueuePush(enum THidQueue queue, const void *report); // false when a full mouse ring refused the report
+void hidQueueRun();  // call every loop pass, sends at USB frame boundaries
+bool hidQueueBusy(); // some report waits
+bool hidQueueEmpty(enum THidQueue queue);
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef KEYPAD_H
+#define KEYPAD_H
+
+#include <Arduino.h>
+
+#define KEY_MATRIX 0       // 1: keys in a row / column matrix (keyRowPin[], keyColPin[]) instead of a pin per key
+#if KEY_MATRIX
+#define KEY_MATRIX_ROWS 6
+#define KEY_MATRIX_COLS 6
+#define NUMBER_OF_LOCAL_KEYS (KEY_MATRIX_ROWS * KEY_MATRIX_COLS) // Count of keys on the MCU pins
+#else
+#define NUMBER_OF_LOCAL_KEYS 8 // Count of keys on the MCU pins
+#endif
+
+// Keys on port expanders (see expander.h) follow the keys on the MCU pins, 16 per MCP23017 on I2C
+// (SDA pin 2, SCL pin 3) or 8 per 74HC165 shift register on SPI (MISO pin 14, SCK pin 15, SS pin
+// 17 and EXPANDER_LOAD_PIN as outputs). Keys, expander keys and combos together fit a 64 bit mask,
+// next to 8 keys on the MCU pins and one combo that is 3 MCP23017 or 6 74HC165. The bus pins are
+// taken from the default pins below, which the compiler checks:
+//   - MCP23017: the encoder gives up DT and SW on pins 3 and 2, encoderPin[] = {4, 1, 0} (pins 0
+//     and 1 have INT2 and INT3 like pins 3 and 2, the UART is not used)
+//   - 74HC165: the last two keys give up pins 14 and 15, keyPin[] = {9, 8, 7, 6, 10, 16, 18, 19}
+//     (A0 and A1, polled instead of waking the MCU)
+#define EXPANDER_NONE 0
+#define EXPANDER_MCP23017 1
+#define EXPANDER_74HC165 2
+#define KEY_EXPANDER EXPANDER_NONE
+#define EXPANDER_CHIPS 0      // up to 4 MCP23017 at I2C address 0x20 and up, up to 8 74HC165 in the order their bytes arrive
+#define EXPANDER_LOAD_PIN 5   // parallel load (SH/LD) of the 74HC165 chain
+#define NUMBER_OF_EXPANDER_KEYS ((KEY_EXPANDER == EXPANDER_MCP23017) ? 16 * EXPANDER_CHIPS \
+                                 : (KEY_EXPANDER == EXPANDER_74HC165) ? 8 * EXPANDER_CHIPS : 0)
+
+#define NUMBER_OF_KEYS (NUMBER_OF_LOCAL_KEYS + NUMBER_OF_EXPANDER_KEYS) // Count of keys in the keyboard
+#define NUMBER_OF_COMBOS 1 // Count of key combinations with a binding of their own (see combo.h)
+#define NUMBER_OF_LAYERS 2 // Count of keymap layers (up to 8), layer 0 is the base layer
+
+#define NUMBER_OF_ENCODERS 1 // Count of rotary encoders (up to 4), each has its own pins and bindings
+
+// Combos follow the keys in the key state machine and in the bindings of every layer, the events
+// of every encoder follow them: a detent clockwise and counterclockwise (with ENCODER_BINDINGS,
+// see encoder.h), the button click, double click and hold
+#define NUMBER_OF_KEYS_AND_COMBOS (NUMBER_OF_KEYS + NUMBER_OF_COMBOS)
+#define ENCODER_CW 0
+#define ENCODER_CCW 1
+#define ENCODER_CLICK 2
+#define ENCODER_DOUBLE_CLICK 3
+#define ENCODER_HOLD 4
+#define ENCODER_EVENTS 5
+#define ENCODER_KEY(encoder, event) (NUMBER_OF_KEYS_AND_COMBOS + (encoder) * ENCODER_EVENTS + (event))
+#define NUMBER_OF_BINDINGS (NUMBER_OF_KEYS_AND_COMBOS + NUMBER_OF_ENCODERS * ENCODER_EVENTS) // bindings per layer
+
+#define DEBOUNCING_MS 20         // wait in ms when key can oscilate
+#define FIRST_REPEAT_CODE_MS 500 // after FIRST_REPEAT_CODE_MS ,s if key is still pressed, start sending the command again
+#define REPEAT_CODE_MS 150       // when sending command by holding down key, wait this long before sending command egain
+
+#define SEQUENCER_SLOTS 4 // Maximum number of key sequences that can be played at the same time
+
+#if KEY_MATRIX
+// Key matrix connections (see keyscan.h), key i of the keymap[] table is at row i / KEY_MATRIX_COLS
+// and column i % KEY_MATRIX_COLS. Rows on one port cost one port read per column.
+constexpr uint8_t keyRowPin[KEY_MATRIX_ROWS] = {9, 8, 10, 16, 14, 15}; // all on port B
+constexpr uint8_t keyColPin[KEY_MATRIX_COLS] = {21, 20, 19, 18, 7, 6};
+#define KEY_MATRIX_DIODES true  // false: no diodes, keys forming a rectangle with a phantom key wait
+#define KEY_MATRIX_SETTLE_US 10 // after switching a column, the pull-ups take a few us to lift the rows
+#else
+// Key connections, the order is the same as in the keymap[] table
+constexpr uint8_t keyPin[NUMBER_OF_LOCAL_KEYS] = {9, 8, 7, 6, 10, 16, 14, 15};
+#endif
+
+// Debounce of every key (see debounce.h), keys not listed defer
+#define DEBOUNCE_DEFER 0 // press and release count after DEBOUNCING_MS without bounce
+#define DEBOUNCE_EAGER 1 // press counts at the first edge, release after DEBOUNCING_MS without bounce
+constexpr uint8_t keyDebounce[NUMBER_OF_KEYS] = {DEBOUNCE_DEFER, DEBOUNCE_DEFER, DEBOUNCE_DEFER, DEBOUNCE_DEFER,
+                                                 DEBOUNCE_DEFER, DEBOUNCE_DEFER, DEBOUNCE_DEFER, DEBOUNCE_DEFER};
+
+// Keys of every combo, bit i is the key i of keyPin[], the expander keys follow. Pressing all keys
+// of a combo within COMBO_TERM_MS plays the binding of the combo instead of the bindings of the keys.
+#define COMBO_TERM_MS 30
+constexpr uint64_t comboKeys[NUMBER_OF_COMBOS] = {(1 << 6) | (1 << 7)};
+
+// Rotary encoder connections, CLK, DT and SW (the button) of every encoder
+#define ENCODER_PINS 3
+constexpr uint8_t encoderPin[NUMBER_OF_ENCODERS * ENCODER_PINS] = {
+  4, 3, 2,
+};
+#define ENCODER_STEPS_PER_NOTCH 4 // quadrature steps between two detents of the encoder
+
+// Defining types
+enum TKeyState {
+  INACTIVE,
+  ACTIVE,
+  HOLDING
+}; // Key states of debounced keys - INACTIVE -> ACTIVE -> HOLDING -> INACTIVE
+//                                                      -> INACTIVE
+typedef struct TKeys {
+  enum TKeyState state;
+  uint16_t repeatMs; // wait before the next repeat
+  uint16_t binding;  // binding found when the key was pressed, used until it is released
+} TKey; // what the key sends is in keymap[], see macro.h
+
+extern TKey key[NUMBER_OF_KEYS_AND_COMBOS];
+
+// Repeat of a held key: the first repeat once more than delayMs passed, the next once more than
+// intervalMs passed, every repeat then comes stepMs sooner down to fastestMs. delayMs 0: the key does not repeat. Every key and
+// combo has a profile in keyRepeat[] (main.cpp), the profiles are defined there too.
+typedef struct TKeyRepeats {
+  uint16_t delayMs;
+  uint16_t intervalMs;
+  uint16_t fastestMs;
+  uint16_t stepMs;
+} TKeyRepeat;
+
+enum TKeyRepeatProfile {
+  KEY_REPEAT_DEFAULT,    // FIRST_REPEAT_CODE_MS, then every REPEAT_CODE_MS
+  KEY_REPEAT_NONE,       // one press, one binding
+  KEY_REPEAT_ACCELERATE, // sooner and faster, for cursor keys and the like
+  KEY_REPEAT_PROFILES
+};
+
+extern const TKeyRepeat keyRepeatProfile[KEY_REPEAT_PROFILES] PROGMEM;
+extern enum TKeyRepeatProfile keyRepeat[NUMBER_OF_KEYS_AND_COMBOS];
+
+#endif
@@ -0,0 +1,290 @@
+#ifndef KEYSCAN_H
+#define KEYSCAN_H
+
+#include "keypad.h"
+
+// Reads all keys at once from the port input registers. The port and bit of every key pin is
+// resolved at compile time from keyPin[], so one scan costs one register read per used port plus
+// a bit test per key.
+//
+// With KEY_MATRIX the keys sit in a row / column matrix (keyRowPin[], keyColPin[]) instead. The
+// columns are driven low one at a time and each column costs one read per port holding rows. The
+// lines need KEY_MATRIX_SETTLE_US after every switch of the column before the rows tell the keys
+// of the new column. Between scans all columns stay low, so any key pulls its row low and its
+// pin interrupt wakes the MCU (see power.h). A matrix without diodes (KEY_MATRIX_DIODES false)
+// shows a phantom fourth key when three keys form three corners of a rectangle, there two
+// columns sharing two or more pressed rows keep their previous state until the rectangle is gone.
+//
+// Keys on port expanders (KEY_EXPANDER, see expander.h) follow the keys on the MCU pins in the
+// mask. Their bus reads run from interrupts, a scan takes the last finished one.
+
+// Bit per key, combos (see combo.h) follow the keys
+static_assert(NUMBER_OF_KEYS_AND_COMBOS <= 64, "a key mask holds up to 64 keys and combos");
+#if NUMBER_OF_KEYS_AND_COMBOS <= 8
+typedef uint8_t TKeyMask;
+#elif NUMBER_OF_KEYS_AND_COMBOS <= 16
+typedef uint16_t TKeyMask;
+#elif NUMBER_OF_KEYS_AND_COMBOS <= 32
+typedef uint32_t TKeyMask;
+#else
+typedef uint64_t TKeyMask;
+#endif
+
+enum TPort {
+  PORT_B,
+  PORT_C,
+  PORT_D,
+  PORT_E,
+  PORT_F,
+  PORT_COUNT
+};
+
+#define PIN_AT(port, bit) (((port) << 3) | (bit))
+
+// Digital pin to port bit mapping of the ATmega32U4 (Leonardo / Pro Micro pin numbering)
+constexpr uint8_t pinMap[] = {
+  PIN_AT(PORT_D, 2), PIN_AT(PORT_D, 3), PIN_AT(PORT_D, 1), PIN_AT(PORT_D, 0), // D0 - D3
+  PIN_AT(PORT_D, 4), PIN_AT(PORT_C, 6), PIN_AT(PORT_D, 7), PIN_AT(PORT_E, 6), // D4 - D7
+  PIN_AT(PORT_B, 4), PIN_AT(PORT_B, 5), PIN_AT(PORT_B, 6), PIN_AT(PORT_B, 7), // D8 - D11
+  PIN_AT(PORT_D, 6), PIN_AT(PORT_C, 7), PIN_AT(PORT_B, 3), PIN_AT(PORT_B, 1), // D12 - D15
+  PIN_AT(PORT_B, 2), PIN_AT(PORT_B, 0), PIN_AT(PORT_F, 7), PIN_AT(PORT_F, 6), // D16 - D19 (A0, A1)
+  PIN_AT(PORT_F, 5), PIN_AT(PORT_F, 4), PIN_AT(PORT_F, 1), PIN_AT(PORT_F, 0), // D20 - D23 (A2 - A5)
+};
+
+constexpr bool pinValid(uint8_t pin) {
+  return pin < sizeof(pinMap);
+}
+
+constexpr uint8_t pinPort(uint8_t pin) {
+  return pinMap[pin] >> 3;
+}
+
+constexpr uint8_t pinBit(uint8_t pin) {
+  return 1 << (pinMap[pin] & 7);
+}
+
+// Bits of the port used by the pins
+constexpr uint8_t pinsPortMask(const uint8_t *pins, uint8_t count, uint8_t port) {
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if (pinPort(pins[i]) == port) {
+      mask |= pinBit(pins[i]);
+    }
+  }
+  return mask;
+}
+
+constexpr bool pinsValid(const uint8_t *pins, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++) {
+    if (!pinValid(pins[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// No pin is in both lists
+constexpr bool pinsDisjoint(const uint8_t *a, uint8_t countA, const uint8_t *b, uint8_t countB) {
+  for (uint8_t i = 0; i < countA; i++) {
+    for (uint8_t j = 0; j < countB; j++) {
+      if (a[i] == b[j]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// No pin is in the list twice
+constexpr bool pinsUnique(const uint8_t *pins, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++) {
+    for (uint8_t j = i + 1; j < count; j++) {
+      if (pins[i] == pins[j]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// No pin is in the list twice or used by an encoder
+constexpr bool pinsDistinct(const uint8_t *pins, uint8_t count) {
+  return pinsUnique(pins, count) && pinsDisjoint(pins, count, encoderPin, sizeof(encoderPin)) &&
+         pinsUnique(encoderPin, sizeof(encoderPin));
+}
+
+// None of the pins is a key pin
+constexpr bool pinsFreeOfKeys(const uint8_t *pins, uint8_t count) {
+#if KEY_MATRIX
+  return pinsDisjoint(pins, count, keyRowPin, KEY_MATRIX_ROWS) && pinsDisjoint(pins, count, keyColPin, KEY_MATRIX_COLS);
+#else
+  return pinsDisjoint(pins, count, keyPin, NUMBER_OF_LOCAL_KEYS);
+#endif
+}
+
+// Snapshot of the input registers of the ports with pins in the list, each read once
+template <const uint8_t *Pins, uint8_t Count>
+static inline void readPorts(uint8_t *snapshot) {
+  if constexpr (pinsPortMask(Pins, Count, PORT_B) != 0) {
+    snapshot[PORT_B] = PINB;
+  }
+  if constexpr (pinsPortMask(Pins, Count, PORT_C) != 0) {
+    snapshot[PORT_C] = PINC;
+  }
+  if constexpr (pinsPortMask(Pins, Count, PORT_D) != 0) {
+    snapshot[PORT_D] = PIND;
+  }
+  if constexpr (pinsPortMask(Pins, Count, PORT_E) != 0) {
+    snapshot[PORT_E] = PINE;
+  }
+  if constexpr (pinsPortMask(Pins, Count, PORT_F) != 0) {
+    snapshot[PORT_F] = PINF;
+  }
+}
+
+// Bit i set when pin i of the list is low, unrolled at compile time so every pin costs just a bit
+// test of the snapshot
+template <typename TMask, const uint8_t *Pins, uint8_t I>
+struct TPinGather {
+  static inline TMask gatherLow(const uint8_t *snapshot) {
+    TMask low = TPinGather<TMask, Pins, I - 1>::gatherLow(snapshot);
+    if (!(snapshot[pinPort(Pins[I - 1])] & pinBit(Pins[I - 1]))) {
+      low |= (TMask)1 << (I - 1);
+    }
+    return low;
+  }
+};
+
+template <typename TMask, const uint8_t *Pins>
+struct TPinGather<TMask, Pins, 0> {
+  static inline TMask gatherLow(const uint8_t *snapshot) {
+    (void)snapshot;
+    return 0;
+  }
+};
+
+// Direction and output registers of the pin, resolved at compile time for a constant pin
+static inline volatile uint8_t *pinDdr(uint8_t pin) {
+  return (pinPort(pin) == PORT_B) ? &DDRB : (pinPort(pin) == PORT_C) ? &DDRC
+         : (pinPort(pin) == PORT_D) ? &DDRD : (pinPort(pin) == PORT_E) ? &DDRE : &DDRF;
+}
+
+static inline volatile uint8_t *pinOut(uint8_t pin) {
+  return (pinPort(pin) == PORT_B) ? &PORTB : (pinPort(pin) == PORT_C) ? &PORTC
+         : (pinPort(pin) == PORT_D) ? &PORTD : (pinPort(pin) == PORT_E) ? &PORTE : &PORTF;
+}
+
+// Drives the pin low or lets the pull-up take it high
+static inline void pinDriveLow(uint8_t pin, bool low) {
+  if (low) {
+    *pinOut(pin) &= ~pinBit(pin);
+    *pinDdr(pin) |= pinBit(pin);
+  } else {
+    *pinDdr(pin) &= ~pinBit(pin);
+    *pinOut(pin) |= pinBit(pin);
+  }
+}
+
+// Drives the pin high or low
+static inline void pinOutput(uint8_t pin, bool high) {
+  if (high) {
+    *pinOut(pin) |= pinBit(pin);
+  } else {
+    *pinOut(pin) &= ~pinBit(pin);
+  }
+  *pinDdr(pin) |= pinBit(pin);
+}
+
+// Row / column matrix, key r * Cols + c is at row r and column c. The rows are inputs with
+// pull-up, the columns are driven low.
+template <const uint8_t *RowPin, uint8_t Rows, const uint8_t *ColPin, uint8_t Cols, bool Diodes, uint8_t SettleUs>
+struct TKeyMatrix {
+  static_assert(Rows <= 8, "a matrix column holds up to 8 rows");
+  static_assert(Rows * Cols <= 64, "a matrix has up to 64 keys");
+
+  static inline uint8_t last[Cols]; // rows of every column of the last scan
+
+  static void begin() {
+    for (uint8_t r = 0; r < Rows; r++) {
+      pinMode(RowPin[r], INPUT_PULLUP);
+    }
+    drive<Cols>(true);
+  }
+
+  // Every column low or released, unrolled so the ports of the pins are known at compile time
+  template <uint8_t C>
+  static inline void drive(bool low) {
+    if constexpr (C > 0) {
+      drive<C - 1>(low);
+      pinDriveLow(ColPin[C - 1], low);
+    }
+  }
+
+  template <uint8_t C>
+  static inline void readColumns(uint8_t *rows) {
+    if constexpr (C > 0) {
+      readColumns<C - 1>(rows);
+      uint8_t snapshot[PORT_COUNT];
+      pinDriveLow(ColPin[C - 1], true);
+      delayMicroseconds(SettleUs);
+      readPorts<RowPin, Rows>(snapshot);
+      pinDriveLow(ColPin[C - 1], false);
+      rows[C - 1] = TPinGather<uint8_t, RowPin, Rows>::gatherLow(snapshot);
+    }
+  }
+
+  static uint64_t scan() {
+    uint8_t rows[Cols];
+    drive<Cols>(false);
+    readColumns<Cols>(rows);
+    drive<Cols>(true);
+    if constexpr (!Diodes) {
+      bool ghost[Cols] = {};
+      for (uint8_t a = 0; a < Cols; a++) {
+        for (uint8_t b = a + 1; b < Cols; b++) {
+          uint8_t shared = rows[a] & rows[b];
+          if (shared & (shared - 1)) {
+            ghost[a] = true;
+            ghost[b] = true;
+          }
+        }
+      }
+      for (uint8_t c = 0; c < Cols; c++) {
+        rows[c] = ghost[c] ? last[c] : rows[c];
+      }
+    }
+    uint64_t pressed = 0;
+    for (uint8_t c = 0; c < Cols; c++) {
+      last[c] = rows[c];
+      for (uint8_t r = 0; r < Rows; r++) {
+        if (rows[c] & (1 << r)) {
+          pressed |= (uint64_t)1 << (r * Cols + c);
+        }
+      }
+    }
+    return pressed;
+  }
+};
+
+#if KEY_MATRIX
+// Pins that change with a key, they wake the MCU
+constexpr const uint8_t *keyInputPin = keyRowPin;
+#define NUMBER_OF_KEY_INPUTS KEY_MATRIX_ROWS
+
+static_assert(pinsValid(keyRowPin, KEY_MATRIX_ROWS) && pinsValid(keyColPin, KEY_MATRIX_COLS), "keyRowPin[] or keyColPin[] contains pin that is not available on ATmega32U4");
+static_assert(pinsDistinct(keyRowPin, KEY_MATRIX_ROWS) && pinsDistinct(keyColPin, KEY_MATRIX_COLS) &&
+              pinsDisjoint(keyRowPin, KEY_MATRIX_ROWS, keyColPin, KEY_MATRIX_COLS), "keyRowPin[], keyColPin[] and the encoder pins use a pin twice");
+#else
+constexpr const uint8_t *keyInputPin = keyPin;
+#define NUMBER_OF_KEY_INPUTS NUMBER_OF_LOCAL_KEYS
+
+static_assert(pinsValid(keyPin, NUMBER_OF_LOCAL_KEYS), "keyPin[] contains pin that is not available on ATmega32U4");
+static_assert(pinsDistinct(keyPin, NUMBER_OF_LOCAL_KEYS), "keyPin[] and the encoder pins use a pin twice");
+#endif
+static_assert(pinsValid(encoderPin, sizeof(encoderPin)), "encoderPin[] contains pin that is not available on ATmega32U4");
+static_assert(NUMBER_OF_ENCODERS <= 4, "up to 4 encoders");
+
+void keyScanBegin();
+TKeyMask keyScan(); // bit i is set when key i is pressed
+
+#endif
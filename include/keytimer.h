@@ -0,0 +1,37 @@
+#ifndef KEYTIMER_H
+#define KEYTIMER_H
+
+#include "keyscan.h"
+
+#define KEY_TIMER_SLOTS 16 // slots of the timer wheel, one per millisecond, power of 2
+
+// Deadlines of the keys and combos (the repeat of held keys, see checkKeys() in main.cpp) in a
+// hashed timer wheel: slot deadline % KEY_TIMER_SLOTS holds a bit per key whose deadline falls
+// on it. keyTimerExpired() only looks at the slots of the milliseconds passed since its last
+// call and only at the keys in them, so a pass costs a slot or two however many keys are held
+// and nothing while no timer runs. A key in a slot with a deadline one or more turns of the
+// wheel ahead stays there for the next turn.
+
+// Index of the lowest key of a mask that is not empty, the key is removed from the mask. Empty
+// bytes are skipped whole, so a walk over a mask costs about the keys in it.
+inline uint8_t keyMaskPop(TKeyMask *mask) {
+  TKeyMask m = *mask;
+  uint8_t i = 0;
+  while (!(uint8_t)m) {
+    m >>= 8;
+    i += 8;
+  }
+  while (!(m & 1)) {
+    m >>= 1;
+    i++;
+  }
+  *mask &= *mask - 1;
+  return i;
+}
+
+void keyTimerBegin();
+void keyTimerSet(uint8_t keyIndex, uint32_t deadlineMs); // replaces a running timer of the key
+void keyTimerCancel(uint8_t keyIndex);
+TKeyMask keyTimerExpired(uint32_t now);                   // keys whose deadline came, their timers stop
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef LAYER_H
+#define LAYER_H
+
+#include "keypad.h"
+
+// Layer stack. Layer 0 is always active, higher layers are switched on by layer bindings
+// (MACRO_LAYER_* in macro.h) and the highest active layer with a non-empty binding decides
+// what a key does. Key bindings of the active layers are resolved in macro.cpp whenever the
+// layers change, the encoder rotation uses the action of the highest active layer.
+
+void layerBegin();
+bool layerBinding(uint16_t binding);          // the binding switches layers
+void layerKey(uint16_t binding, bool press); // a key with a layer binding was pressed or released
+void layerKeyDone();                         // a key with another binding was pressed, one-shot layers end
+void layerHold(uint8_t layer, bool press);   // a tap-hold key holds the layer like a momentary layer key
+uint8_t layerTop();                          // highest active layer
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef MACRO_H
+#define MACRO_H
+
+#include "keypad.h"
+
+// Key bindings are one byte stream in flash (keymap[] in main.cpp). Every layer has one binding
+// per key in the order of keyPin[] followed by the encoder button events, the layers follow each
+// other from layer 0. A binding is a list of operations ended by MACRO_END. Keys of a step are
+// collected until MACRO_TAP or MACRO_PRESS, which presses them, waits and releases them. A step
+// can mix keyboard, consumer, system keys and mouse buttons, mouse moves and scrolls happen when
+// the step is pressed. A step without keys only waits. A binding starting with a hold operation
+// is a tap-hold key (see taphold.h): the rest of the binding plays on a tap.
+// An empty binding (just MACRO_END) is transparent: the binding of the next lower active layer
+// is used. Layer and mouse keys operations are the only operation of their binding.
+#define OP_END 0x00      // end of the binding
+#define OP_KEY 0x01      // keyboard key of the step, 1 byte key code
+#define OP_MOD 0x02      // keyboard key held down for the whole sequence, 1 byte key code
+#define OP_CONSUMER 0x03 // consumer key of the step, 2 bytes key code (LSB first)
+#define OP_SYSTEM 0x04   // system key of the step, 1 byte key code
+#define OP_TAP 0x05      // press the keys of the step and release them right away
+#define OP_PRESS 0x06    // press the keys of the step and release them after 2 bytes ms (LSB first)
+#define OP_LAYER_MOMENTARY 0x07 // the layer (1 byte) is active while the key is held down
+#define OP_LAYER_TOGGLE 0x08    // every press switches the layer (1 byte) on or off
+#define OP_LAYER_ONESHOT 0x09   // the layer (1 byte) is active for the next key press
+#define OP_MOUSE_BUTTON 0x0A    // mouse buttons of the step, 1 byte MOUSE_LEFT | MOUSE_RIGHT | MOUSE_MIDDLE
+#define OP_MOUSE_MOVE 0x0B      // pointer move of the step, 1 byte x, 1 byte y (signed)
+#define OP_MOUSE_SCROLL 0x0C    // scroll of the step in notches, 1 byte wheel, 1 byte pan (signed)
+#define OP_HOLD_MOD 0x0D        // held down, the keyboard key (1 byte) is pressed instead of the binding
+#define OP_HOLD_LAYER 0x0E      // held down, the layer (1 byte) is active instead of the binding
+#define OP_MOUSE_KEYS 0x0F      // held down, the pointer moves or scrolls in the directions (1 byte MOUSE_KEY_*, see mousekeys.h)
+
+#define MACRO_END OP_END
+#define MACRO_KEY(code) OP_KEY, (uint8_t)(code)
+#define MACRO_MOD(code) OP_MOD, (uint8_t)(code)
+#define MACRO_CONSUMER(code) OP_CONSUMER, lowByte(code), highByte(code)
+#define MACRO_SYSTEM(code) OP_SYSTEM, (uint8_t)(code)
+#define MACRO_TAP OP_TAP
+#define MACRO_PRESS(ms) OP_PRESS, lowByte(ms), highByte(ms)
+#define MACRO_NONE OP_TAP // blocks the binding of lower layers, sends nothing
+#define MACRO_LAYER_MOMENTARY(layer) OP_LAYER_MOMENTARY, (uint8_t)(layer)
+#define MACRO_LAYER_TOGGLE(layer) OP_LAYER_TOGGLE, (uint8_t)(layer)
+#define MACRO_LAYER_ONESHOT(layer) OP_LAYER_ONESHOT, (uint8_t)(layer)
+#define MACRO_MOUSE_BUTTON(buttons) OP_MOUSE_BUTTON, (uint8_t)(buttons)
+#define MACRO_MOUSE_MOVE(x, y) OP_MOUSE_MOVE, (uint8_t)(int8_t)(x), (uint8_t)(int8_t)(y)
+#define MACRO_MOUSE_SCROLL(wheel, pan) OP_MOUSE_SCROLL, (uint8_t)(int8_t)(wheel), (uint8_t)(int8_t)(pan)
+#define MACRO_WAIT(ms) MACRO_PRESS(ms) // a step without keys
+#define MACRO_HOLD_MOD(code) OP_HOLD_MOD, (uint8_t)(code)
+#define MACRO_HOLD_LAYER(layer) OP_HOLD_LAYER, (uint8_t)(layer)
+#define MACRO_MOUSE_KEYS(directions) OP_MOUSE_KEYS, (uint8_t)(directions)
+
+#define KEYMAP_FORMAT 2 // changes with the meaning of the operations, keymaps of other formats are not loaded
+#define KEYMAP_BINDINGS (NUMBER_OF_LAYERS * NUMBER_OF_BINDINGS)
+
+#define KEYMAP_MAX_SIZE 496 // bytes of the keymap in RAM and of each EEPROM slot (config.h), keymap[] and keymaps sent over Raw HID must fit
+#define KEYMAP_STEP_KEYS 6  // keys of a step plus held keys that are not modifiers, slots of the keyboard report
+
+// Bytes of a keymap that taps one key on every binding of layer 0 (MACRO_KEY, MACRO_TAP,
+// MACRO_END) and leaves the other layers transparent, the least a keypad of that size needs
+constexpr uint16_t keymapBaseSize(uint16_t layers, uint16_t bindings) {
+  return bindings * 4 + (layers - 1) * bindings;
+}
+
+// Result of keymapCheck()
+enum TKeymapCheck {
+  KEYMAP_OK,
+  KEYMAP_TOO_LARGE,       // more than KEYMAP_MAX_SIZE bytes
+  KEYMAP_BAD_OPERATION,   // unknown opcode
+  KEYMAP_TRUNCATED,       // an operation or the bindings of the last layer run past the end
+  KEYMAP_BAD_KEY_CODE,    // keyboard key code 0 or above KEY_RIGHT_GUI, consumer or system key code 0, unknown mouse button, no mouse key direction
+  KEYMAP_BAD_LAYER,       // layer number not below NUMBER_OF_LAYERS
+  KEYMAP_LAYER_NOT_ALONE, // layer or mouse keys operation with other operations in its binding
+  KEYMAP_TOO_MANY_KEYS,   // a step presses more than KEYMAP_STEP_KEYS keys at once
+  KEYMAP_HOLD_NOT_FIRST,  // hold operation that does not start its binding
+  KEYMAP_TRAILING_BYTES   // data after the last binding of the last layer, a layer has too many bindings
+};
+
+// Bytes of the operation including the opcode, 0 if unknown
+constexpr uint8_t macroOpLength(uint8_t op) {
+  return ((op == OP_END) || (op == OP_TAP)) ? 1
+         : ((op == OP_CONSUMER) || (op == OP_PRESS) || (op == OP_MOUSE_MOVE) || (op == OP_MOUSE_SCROLL)) ? 3
+         : (op <= OP_MOUSE_KEYS) ? 2
+         : 0;
+}
+
+// Key codes KEY_LEFT_CTRL - KEY_RIGHT_GUI go to the modifier byte of the keyboard report
+constexpr bool macroModifier(uint8_t code) {
+  return (code >= 0xE0) && (code <= 0xE7);
+}
+
+// Checks a keymap of size bytes, read(pos) returns the byte at pos. It runs at compile time on
+// keymap[] (see KEYMAP_ASSERT) and at run time on keymaps committed over Raw HID, so the player
+// never meets an operation it can not send.
+template <typename TRead>
+constexpr enum TKeymapCheck keymapCheck(TRead read, uint16_t size) {
+  if (size > KEYMAP_MAX_SIZE) {
+    return KEYMAP_TOO_LARGE;
+  }
+  uint16_t pos = 0;
+  for (uint16_t i = 0; i < KEYMAP_BINDINGS; i++) {
+    uint16_t first = pos;
+    uint8_t held = 0;
+    uint8_t keys = 0;
+    for (uint8_t op = 0; (pos < size) && ((op = read(pos)) != OP_END); ) {
+      uint8_t length = macroOpLength(op);
+      if (!length) {
+        return KEYMAP_BAD_OPERATION;
+      }
+      if (pos + length > size) {
+        return KEYMAP_TRUNCATED;
+      }
+      uint8_t arg = (length > 1) ? read(pos + 1) : 0;
+      if ((((op == OP_KEY) || (op == OP_MOD) || (op == OP_HOLD_MOD)) && ((arg == 0) || (arg > 0xE7))) ||
+          ((op == OP_CONSUMER) && (arg == 0) && (read(pos + 2) == 0)) || ((op == OP_SYSTEM) && (arg == 0)) ||
+          ((op == OP_MOUSE_BUTTON) && ((arg == 0) || (arg & ~0x07))) || ((op == OP_MOUSE_KEYS) && (arg == 0))) {
+        return KEYMAP_BAD_KEY_CODE;
+      }
+      if (((op == OP_HOLD_MOD) || (op == OP_HOLD_LAYER)) && (pos != first)) {
+        return KEYMAP_HOLD_NOT_FIRST;
+      }
+      if ((op == OP_HOLD_LAYER) && (arg >= NUMBER_OF_LAYERS)) {
+        return KEYMAP_BAD_LAYER;
+      }
+      if ((op == OP_LAYER_MOMENTARY) || (op == OP_LAYER_TOGGLE) || (op == OP_LAYER_ONESHOT) || (op == OP_MOUSE_KEYS)) {
+        if ((op != OP_MOUSE_KEYS) && (arg >= NUMBER_OF_LAYERS)) {
+          return KEYMAP_BAD_LAYER;
+        }
+        if ((pos != first) || ((pos + length < size) && (read(pos + length) != OP_END))) {
+          return KEYMAP_LAYER_NOT_ALONE;
+        }
+      }
+      held += (op == OP_MOD) && (!macroModifier(arg));
+      keys += (op == OP_KEY) && (!macroModifier(arg));
+      if (held + keys > KEYMAP_STEP_KEYS) {
+        return KEYMAP_TOO_MANY_KEYS;
+      }
+      keys = ((op == OP_TAP) || (op == OP_PRESS)) ? 0 : keys;
+      pos += length;
+    }
+    if (pos >= size) {
+      return KEYMAP_TRUNCATED;
+    }
+    pos++;
+  }
+  return (pos == size) ? KEYMAP_OK : KEYMAP_TRAILING_BYTES;
+}
+
+// Stops the build with the first problem of a keymap array defined constexpr
+#define KEYMAP_ASSERT(map)                                                                                                      \
+  constexpr enum TKeymapCheck map##Checked = keymapCheck([](uint16_t pos) { return map[pos]; }, sizeof(map));                   \
+  static_assert(map##Checked != KEYMAP_TOO_LARGE, #map "[] does not fit into KEYMAP_MAX_SIZE");                                 \
+  static_assert(map##Checked != KEYMAP_BAD_OPERATION, #map "[] contains an unknown operation");                                 \
+  static_assert(map##Checked != KEYMAP_TRUNCATED, #map "[] has fewer bindings than NUMBER_OF_LAYERS * NUMBER_OF_BINDINGS");     \
+  static_assert(map##Checked != KEYMAP_BAD_KEY_CODE, #map "[] contains a key code out of range");                               \
+  static_assert(map##Checked != KEYMAP_BAD_LAYER, #map "[] switches to a layer not below NUMBER_OF_LAYERS");                    \
+  static_assert(map##Checked != KEYMAP_LAYER_NOT_ALONE, #map "[] has a layer or mouse keys operation not alone in a binding");  \
+  static_assert(map##Checked != KEYMAP_TOO_MANY_KEYS, #map "[] presses more keys at once than the keyboard report holds");      \
+  static_assert(map##Checked != KEYMAP_HOLD_NOT_FIRST, #map "[] has a hold operation that does not start its binding");         \
+  static_assert(map##Checked != KEYMAP_TRAILING_BYTES, #map "[] has more bindings than NUMBER_OF_LAYERS * NUMBER_OF_BINDINGS")
+
+extern const uint8_t keymap[] PROGMEM;
+extern const uint16_t keymapSize;
+
+// Bindings are read from a copy of the keymap in RAM, so replacing the keymap (config.h) only
+// costs a copy of the new one and keys never wait for flash or EEPROM
+extern uint8_t macroCache[KEYMAP_MAX_SIZE];
+extern uint16_t macroCacheSize;
+
+void macroBegin();                       // use keymap[] built into the firmware
+void macroBind();                        // find the binding of every key after macroCache[] changed
+void macroLayers(uint8_t layerMask);     // resolve bindings of the keys for the active layers (bit per layer)
+uint16_t macroBinding(uint8_t keyIndex); // position of the first operation of the key binding in the active layers
+uint8_t macroByte(uint16_t pos);         // OP_END beyond the end of the keymap
+uint16_t macroWord(uint16_t pos);
+uint16_t macroNext(uint16_t pos);        // position of the operation following the one at pos
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef MOUSEKEYS_H
+#define MOUSEKEYS_H
+
+#include "keypad.h"
+
+// Speeds in 1/256 pixel (move) or 1/256 of 1/HMOUSE_HIRES_RESOLUTION notch (wheel, pan) per USB
+// frame (1 ms), accelerations in the same units per frame
+#define MOUSEKEYS_MOVE_START 64    // 250 pixels per second at the first frame
+#define MOUSEKEYS_MOVE_MAX 768     // 3000 pixels per second
+#define MOUSEKEYS_MOVE_ACCEL 1     // full speed after 0.7 s
+#define MOUSEKEYS_WHEEL_START 256  // 8 notches per second
+#define MOUSEKEYS_WHEEL_MAX 1280   // 40 notches per second
+#define MOUSEKEYS_WHEEL_ACCEL 2    // full speed after 0.5 s
+#define MOUSEKEYS_DIAGONAL 181     // speed of each axis of a diagonal in 1/256, 1/sqrt(2)
+
+// Directions of MACRO_MOUSE_KEYS() (see macro.h)
+#define MOUSE_KEY_UP 0x01
+#define MOUSE_KEY_DOWN 0x02
+#define MOUSE_KEY_LEFT 0x04
+#define MOUSE_KEY_RIGHT 0x08
+#define MOUSE_KEY_WHEEL_UP 0x10
+#define MOUSE_KEY_WHEEL_DOWN 0x20
+#define MOUSE_KEY_PAN_LEFT 0x40
+#define MOUSE_KEY_PAN_RIGHT 0x80
+#define MOUSE_KEY_MOVES 0x0F
+#define MOUSE_KEY_SCROLLS 0xF0
+
+// Mouse keys move the pointer and scroll while they are held down. The pointer and the scroll
+// have a speed each, in 1/256 units per USB frame, that starts at *_START with the first key and
+// grows by *_ACCEL every frame up to *_MAX, so a short press moves a pixel or two and a long one
+// crosses the screen. mouseKeysRun() advances the motion once per frame passed since its last
+// call: the speed goes to the held directions, opposite directions cancel and both axes of a
+// diagonal get MOUSEKEYS_DIAGONAL of the speed, so the pointer moves as fast in every direction.
+// Fractions of a pixel (a notch) are carried to the next frame, so slow speeds move evenly instead
+// of stalling and no distance is lost or rounded up. The moves go to the pending mouse report
+// (report.h), the mouse queue sums them until the host polls. All of it is integer arithmetic.
+// The speed of moves or scrolls starts over when their last key goes up.
+
+void mouseKeysBegin();
+bool mouseKeysBinding(uint16_t binding);         // the binding holds mouse key directions
+void mouseKeysKey(uint16_t binding, bool press); // a key with a mouse keys binding was pressed or released
+void mouseKeysRun();                             // call every loop pass before reportSend()
+bool mouseKeysBusy();                            // a direction is held
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include "keypad.h"
+
+#define SLEEP_WHEN_IDLE true // sleep in IDLE mode between events instead of busy polling
+
+// Key pins (the rows of a key matrix) and encoder pins with an external (INTn) or pin change
+// (PCINTn) interrupt wake the MCU on an edge. Other pins are polled on the next wake up, which
+// comes at least every millisecond from the millis() timer and the USB start of frame interrupt -
+// still well within the debounce time and the USB polling interval. The encoder pin interrupts
+// decode the rotation themselves (see rotary.h).
+
+void powerBegin();
+void powerSleep(bool busy); // sleep until the next interrupt unless busy or an edge is pending
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <HID-Project.h>
+#include "keypad.h"
+
+// Keyboard, consumer, system and mouse reports are assembled here instead of by Keyboard,
+// Consumer, System and HMouse, which send a report for every press() and release(). Presses and
+// releases of one loop pass only change the pending reports, reportSend() at the end of the pass
+// queues each report that differs from the one queued before (see hidqueue.h), so a pass costs
+// at most one report of each kind. Mouse moves and scrolls add up until the next mouse report.
+// A key pressed and released in the same pass is never seen by the host, callers that need both
+// wait for reportCount() to change between them. Keyboard keys, modifiers, consumer keys and
+// mouse buttons count their presses: a key pressed by two sequences goes up with the last
+// release.
+
+void reportKeyboardPress(KeyboardKeycode key); // modifier keys go to the modifier bits
+void reportKeyboardRelease(KeyboardKeycode key);
+void reportConsumerPress(ConsumerKeycode key);
+void reportConsumerRelease(ConsumerKeycode key);
+void reportSystemPress(SystemKeycode key); // the report has room for one system key
+void reportSystemRelease(SystemKeycode key);
+void reportMousePress(uint8_t buttons); // MOUSE_LEFT | MOUSE_RIGHT | MOUSE_MIDDLE
+void reportMouseRelease(uint8_t buttons);
+void reportMouseMove(int8_t x, int8_t y);
+void reportMouseScroll(int16_t wheel, int16_t pan); // in 1/HMOUSE_HIRES_RESOLUTION of a notch
+void reportSend();
+uint8_t reportCount(); // passes of reportSend(), wraps around
+bool reportReady();    // the host got every report queued, the next one goes out in the next frame
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef ROTARY_H
+#define ROTARY_H
+
+#include "keypad.h"
+
+#define ROTARY_BUTTON_DEBOUNCE_MS 10  // the button level counts once it did not change for this long
+#define ROTARY_DOUBLE_CLICK_MS 600    // a second click within this time is a double click
+#define ROTARY_HOLD_MS 1200           // a press longer than this is a hold, no click
+
+// Pins of an encoder, shifted by ENCODER_PINS * encoder in the argument of rotaryInterrupt()
+#define ROTARY_CLK 0x01
+#define ROTARY_DT 0x02
+#define ROTARY_SW 0x04
+
+// Rotary encoder inputs. Every pin interrupt (see power.cpp) samples the pins of all encoders in
+// one pass: one read per port holding encoder pins, resolved at compile time like the key scan,
+// then a transition table lookup per encoder. The steps add up in a delta per encoder with the
+// time of the last step edge, which rotaryRead() takes in the loop as the event time (the rate of
+// the acceleration curves, see encoder.h, is measured from it), so an encoder more costs a few
+// cycles per interrupt and no step is lost however many come between two loop passes. Pins without an interrupt (on the Pro
+// Micro pin 4 on PD4) are sampled by every interrupt of the other pins and by rotaryPoll(), a step
+// missed in between shows up as a double transition and is resolved by the pin whose edge fired.
+// The interrupts keep the button level and the time of its last edge, clicks, double clicks and
+// holds are resolved from the debounced level like ClickEncoder did.
+
+enum TRotaryEventType {
+  ROTARY_STEP,        // steps quadrature steps, positive clockwise
+  ROTARY_CLICK,
+  ROTARY_DOUBLE_CLICK,
+  ROTARY_HOLD         // the button is held for ROTARY_HOLD_MS, its release is no click then
+};
+
+typedef struct TRotaryEvents {
+  enum TRotaryEventType type;
+  uint8_t encoder;
+  int16_t steps;
+  uint32_t timeMs; // millis() when it happened, of the last step for ROTARY_STEP
+} TRotaryEvent;
+
+void rotaryBegin();
+void rotaryInterrupt(uint16_t pins); // interrupt context, pins: ROTARY_* pins of the encoders whose edge fired
+void rotaryPoll();                   // samples the pins from the loop
+bool rotaryRead(TRotaryEvent *event, uint32_t now);
+bool rotaryBusy();                   // steps wait or a button level is not settled
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef SEQUENCER_H
+#define SEQUENCER_H
+
+#include "keypad.h"
+
+// Plays key sequences (keymap bindings, see macro.h) without blocking the main loop. Every started sequence
+// occupies one of SEQUENCER_SLOTS slots and is advanced by sequencerRun() from loop(), so keys
+// and the rotary encoder are still serviced while a long macro is being typed.
+
+void sequencerBegin();
+bool sequencerStart(uint8_t keyIndex, uint16_t binding, uint32_t now); // false if the key is already playing or all slots are busy
+void sequencerRun(uint32_t now);
+bool sequencerBusy();
+
+#endif
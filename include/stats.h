@@ -0,0 +1,38 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "keypad.h"
+#include "configprotocol.h"
+
+// Build with -DSTATS to collect histograms of the loop, interrupt, latency and USB send times and
+// counters of merged and lost events, tools/keypadcfg stats reads them over Raw HID. Timer3 counts
+// CPU cycles and wakes the MCU on its overflow every 4 ms. Without STATS the calls below are empty
+// and compile to nothing.
+
+#ifdef STATS
+
+void statsBegin();
+uint32_t statsCycles();                                     // CPU cycles since statsBegin(), wraps around
+void statsRecord(enum TStatsHistogram histogram, uint32_t cycles);
+void statsSince(enum TStatsHistogram histogram, uint32_t start); // records statsCycles() - start
+void statsCount(enum TStatsCounter counter, uint16_t n = 1);
+void statsKeyEvent();                // debounced key change
+void statsReportQueued(bool queued); // end of the pass, a key change without a report is not measured
+void statsReportSent();              // the first keyboard, consumer or system report after the key change measures STATS_LATENCY
+void statsRead(uint16_t offset, uint8_t length, void *data); // part of TConfigStats
+void statsClear();
+
+#else
+
+inline void statsBegin() {}
+inline uint32_t statsCycles() { return 0; }
+inline void statsRecord(enum TStatsHistogram, uint32_t) {}
+inline void statsSince(enum TStatsHistogram, uint32_t) {}
+inline void statsCount(enum TStatsCounter, uint16_t = 1) {}
+inline void statsKeyEvent() {}
+inline void statsReportQueued(bool) {}
+inline void statsReportSent() {}
+
+#endif
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "keypad.h"
+
+#define STREAM_BUFFER 64 // keys waiting to be typed, power of 2
+
+// Types text sent by the host with CONFIG_TYPE (see configprotocol.h), any length at the rate
+// the keyboard endpoint takes it. A key is pressed in one report and released with the press of
+// the next one, so a key takes one USB frame. A key following itself or needing other modifiers
+// gets a report of its own that releases the previous one, otherwise the host would see no new
+// press or the previous key with the new modifiers. The host sends no more keys than
+// streamFree() tells it, so nothing is dropped.
+
+bool streamWrite(const uint8_t *pairs, uint8_t count); // queue (modifier bits, key code) pairs, false if they do not fit
+uint8_t streamFree();    // keys that fit into the buffer
+uint8_t streamPending(); // keys queued or held down
+void streamRun();
+bool streamBusy();
+
+#endif
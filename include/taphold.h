@@ -0,0 +1,27 @@
+#ifndef TAPHOLD_H
+#define TAPHOLD_H
+
+#include "keyscan.h"
+
+#define TAP_HOLD_TERM_MS 200          // a tap-hold key held down this long is a hold
+#define TAP_HOLD_PERMISSIVE true      // another key pressed and released while a tap-hold key is down makes it a hold
+#define TAP_HOLD_ON_OTHER_PRESS false // another key pressed while a tap-hold key is down makes it a hold
+#define TAP_HOLD_BUFFER 16            // key events waiting for a decision, power of 2
+
+// Tap-hold keys (bindings starting with MACRO_HOLD_MOD or MACRO_HOLD_LAYER, see macro.h) play the
+// rest of their binding on a tap and hold a key or a layer while held down. The debounced key
+// changes go through a buffer: while a tap-hold key waits for its decision the changes of other
+// keys wait behind it, so they see the decided key or layer. The decision comes with the first
+// of
+//   - the release of the tap-hold key: a tap, played right away,
+//   - TAP_HOLD_TERM_MS after its press: a hold,
+//   - another key pressed (TAP_HOLD_ON_OTHER_PRESS) or pressed and released (TAP_HOLD_PERMISSIVE)
+//     before the release: a hold,
+// then the waiting changes are replayed in order, one change per key and loop pass so the key
+// state machine sees every press and release. Tap-hold keys themselves never reach it.
+
+void tapHoldBegin();
+TKeyMask tapHold(TKeyMask pressed, uint32_t now); // debounced keys -> keys for the key state machine
+bool tapHoldBusy();                               // a decision or buffered changes wait, or a hold is down
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef USBFRAME_H
+#define USBFRAME_H
+
+#include <Arduino.h>
+
+// Number of the current USB frame (low byte). The host sends start of frame every 1 ms and
+// polls the interrupt endpoints once per frame, so sending more than one report of a kind
+// within the same frame only fills the endpoint buffers.
+inline uint8_t usbFrame() {
+  return UDFNUML;
+}
+
+#endif
@@ -0,0 +1,35 @@
+/*
+  HCore.cpp
+
+  Copyright (c) 2015, Arduino LLC
+  Original code (pre-library): Copyright (c) 2011, Peter Barrett
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "HCore.h"
+
+#if defined(_USING_HID)
+
+bool HCore_::ready(uint8_t length)
+{
+	// a pointer to the member named through the derived class reaches it in HID() as well
+	uint8_t endpoint = HID().*(&HCore_::pluggedEndpoint);
+	// USB_SendSpace() is 0 while the host did not take the previous report yet, the report id
+	// goes first
+	return USB_SendSpace(endpoint) >= length + 1;
+}
+
+#endif
@@ -23,15 +23,21 @@
 
 #if defined(_USING_HID)
 
+#define HMOUSE_REPORT_ID 1
+
+#ifndef HID_REPORT_TYPE_FEATURE
+#define HID_REPORT_TYPE_FEATURE 3
+#endif
+
 static const uint8_t _hidReportDescriptor[] PROGMEM = {
   
   //  Mouse
-    0x05, 0x01,                    // USAGE_PAGE (Generic Desktop)  // 54
+    0x05, 0x01,                    // USAGE_PAGE (Generic Desktop)
     0x09, 0x02,                    // USAGE (Mouse)
     0xa1, 0x01,                    // COLLECTION (Application)
     0x09, 0x01,                    //   USAGE (Pointer)
     0xa1, 0x00,                    //   COLLECTION (Physical)
-    0x85, 0x01,                    //     REPORT_ID (1)
+    0x85, HMOUSE_REPORT_ID,        //     REPORT_ID (1)
     0x05, 0x09,                    //     USAGE_PAGE (Button)
     0x19, 0x01,                    //     USAGE_MINIMUM (Button 1)
     0x29, 0x03,                    //     USAGE_MAXIMUM (Button 3)
@@ -46,20 +52,52 @@ static const uint8_t _hidReportDescriptor[] PROGMEM = {
     0x05, 0x01,                    //     USAGE_PAGE (Generic Desktop)
     0x09, 0x30,                    //     USAGE (X)
     0x09, 0x31,                    //     USAGE (Y)
-    0x09, 0x38,                    //     USAGE (Wheel)
     0x15, 0x81,                    //     LOGICAL_MINIMUM (-127)
     0x25, 0x7f,                    //     LOGICAL_MAXIMUM (127)
     0x75, 0x08,                    //     REPORT_SIZE (8)
-    0x95, 0x03,                    //     REPORT_COUNT (3)
+    0x95, 0x02,                    //     REPORT_COUNT (2)
     0x81, 0x06,                    //     INPUT (Data,Var,Rel)
+    // Wheel with its Resolution Multiplier - Microsoft "Enhanced Wheel Support", also used by Linux
+    0xa1, 0x02,                    //     COLLECTION (Logical)
+    0x09, 0x48,                    //       USAGE (Resolution Multiplier)
+    0x15, 0x00,                    //       LOGICAL_MINIMUM (0)
+    0x25, 0x01,                    //       LOGICAL_MAXIMUM (1)
+    0x35, 0x01,                    //       PHYSICAL_MINIMUM (1)
+    0x45, HMOUSE_HIRES_RESOLUTION, //       PHYSICAL_MAXIMUM (120)
+    0x75, 0x02,                    //       REPORT_SIZE (2)
+    0x95, 0x01,                    //       REPORT_COUNT (1)
+    0xb1, 0x02,                    //       FEATURE (Data,Var,Abs)
+    0x35, 0x00,                    //       PHYSICAL_MINIMUM (0)
+    0x45, 0x00,                    //       PHYSICAL_MAXIMUM (0)
+    0x09, 0x38,                    //       USAGE (Wheel)
+    0x16, 0x01, 0x80,              //       LOGICAL_MINIMUM (-32767)
+    0x26, 0xff, 0x7f,              //       LOGICAL_MAXIMUM (32767)
+    0x75, 0x10,                    //       REPORT_SIZE (16)
+    0x95, 0x01,                    //       REPORT_COUNT (1)
+    0x81, 0x06,                    //       INPUT (Data,Var,Rel)
+    0xc0,                          //     END_COLLECTION
     //https://arduino.stackexchange.com/questions/46055/can-the-mouse-library-scroll-horizontally
-    0x05, 0x0c,        //       USAGE PAGE (Consumer Devices) 
-    0x0a, 0x38, 0x02,  //       USAGE (AC Pan)
-    0x15, 0x81,        //       LOGICAL_MINIMUM (-127)
-    0x25, 0x7f,        //       LOGICAL_MAXIMUM (127)
-    0x75, 0x08,        //       REPORT_SIZE (8)
-    0x95, 0x01,        //       REPORT_COUNT (1)
-    0x81, 0x06,        //       INPUT (Data, Var, Rel)
+    0xa1, 0x02,                    //     COLLECTION (Logical)
+    0x09, 0x48,                    //       USAGE (Resolution Multiplier)
+    0x15, 0x00,                    //       LOGICAL_MINIMUM (0)
+    0x25, 0x01,                    //       LOGICAL_MAXIMUM (1)
+    0x35, 0x01,                    //       PHYSICAL_MINIMUM (1)
+    0x45, HMOUSE_HIRES_RESOLUTION, //       PHYSICAL_MAXIMUM (120)
+    0x75, 0x02,                    //       REPORT_SIZE (2)
+    0x95, 0x01,                    //       REPORT_COUNT (1)
+    0xb1, 0x02,                    //       FEATURE (Data,Var,Abs)
+    0x35, 0x00,                    //       PHYSICAL_MINIMUM (0)
+    0x45, 0x00,                    //       PHYSICAL_MAXIMUM (0)
+    0x75, 0x04,                    //       REPORT_SIZE (4)
+    0xb1, 0x03,                    //       FEATURE (Cnst,Var,Abs)
+    0x05, 0x0c,                    //       USAGE PAGE (Consumer Devices)
+    0x0a, 0x38, 0x02,              //       USAGE (AC Pan)
+    0x16, 0x01, 0x80,              //       LOGICAL_MINIMUM (-32767)
+    0x26, 0xff, 0x7f,              //       LOGICAL_MAXIMUM (32767)
+    0x75, 0x10,                    //       REPORT_SIZE (16)
+    0x95, 0x01,                    //       REPORT_COUNT (1)
+    0x81, 0x06,                    //       INPUT (Data,Var,Rel)
+    0xc0,                          //     END_COLLECTION
     0xc0,                          //   END_COLLECTION
     0xc0,                          // END_COLLECTION
 };
@@ -79,10 +117,97 @@ signed char limit_xy(int const xy)
   else               return xy;
 }
 
-HMouse_::HMouse_(void) : _buttons(0)
+/* Wheel and pan are 16 bit fields */
+static int16_t limit_wheel(long const wheel)
+{
+  if     (wheel < -32767) return -32767;
+  else if(wheel >  32767) return 32767;
+  else                    return wheel;
+}
+
+HMouse_::HMouse_(void) : PluggableUSBModule(1, 1, _epType),
+	_buttons(0), _multiplier(0), _wheelRemainder(0), _panRemainder(0),
+	_protocol(HID_REPORT_PROTOCOL), _idle(1)
 {
-    static HIDSubDescriptor node(_hidReportDescriptor, sizeof(_hidReportDescriptor));
-    HID().AppendDescriptor(&node);
+	_epType[0] = EP_TYPE_INTERRUPT_IN;
+	PluggableUSB().plug(this);
+}
+
+int HMouse_::getInterface(uint8_t* interfaceCount)
+{
+	*interfaceCount += 1; // uses 1
+	HIDDescriptor hidInterface = {
+		D_INTERFACE(pluggedInterface, 1, USB_DEVICE_CLASS_HUMAN_INTERFACE, HID_SUBCLASS_NONE, HID_PROTOCOL_NONE),
+		D_HIDREPORT(sizeof(_hidReportDescriptor)),
+		D_ENDPOINT(USB_ENDPOINT_IN(pluggedEndpoint), USB_ENDPOINT_TYPE_INTERRUPT, USB_EP_SIZE, 0x01)
+	};
+	return USB_SendControl(0, &hidInterface, sizeof(hidInterface));
+}
+
+int HMouse_::getDescriptor(USBSetup& setup)
+{
+	// Check if this is a HID Class Descriptor request for our interface
+	if (setup.bmRequestType != REQUEST_DEVICETOHOST_STANDARD_INTERFACE) { return 0; }
+	if (setup.wValueH != HID_REPORT_DESCRIPTOR_TYPE) { return 0; }
+	if (setup.wIndex != pluggedInterface) { return 0; }
+
+	// The host reads the descriptor when it (re)enumerates the device and sets the
+	// multiplier again afterwards if it supports high-resolution scrolling
+	_protocol = HID_REPORT_PROTOCOL;
+	_multiplier = 0;
+	_wheelRemainder = 0;
+	_panRemainder = 0;
+
+	return USB_SendControl(TRANSFER_PGM, _hidReportDescriptor, sizeof(_hidReportDescriptor));
+}
+
+bool HMouse_::setup(USBSetup& setup)
+{
+	if (pluggedInterface != setup.wIndex) {
+		return false;
+	}
+
+	uint8_t request = setup.bRequest;
+	uint8_t requestType = setup.bmRequestType;
+
+	if (requestType == REQUEST_DEVICETOHOST_CLASS_INTERFACE)
+	{
+		if ((request == HID_GET_REPORT) && (setup.wValueH == HID_REPORT_TYPE_FEATURE)) {
+			uint8_t feature[2] = { HMOUSE_REPORT_ID, _multiplier };
+			USB_SendControl(0, feature, sizeof(feature));
+			return true;
+		}
+		if (request == HID_GET_PROTOCOL) {
+			USB_SendControl(0, &_protocol, 1);
+			return true;
+		}
+		if (request == HID_GET_IDLE) {
+			USB_SendControl(0, &_idle, 1);
+			return true;
+		}
+	}
+
+	if (requestType == REQUEST_HOSTTODEVICE_CLASS_INTERFACE)
+	{
+		if (request == HID_SET_PROTOCOL) {
+			_protocol = setup.wValueL;
+			return true;
+		}
+		if (request == HID_SET_IDLE) {
+			_idle = setup.wValueL;
+			return true;
+		}
+		if ((request == HID_SET_REPORT) && (setup.wValueH == HID_REPORT_TYPE_FEATURE) && (setup.wLength == 2)) {
+			uint8_t feature[2];
+			USB_RecvControl(feature, sizeof(feature));
+			if (feature[0] == HMOUSE_REPORT_ID) {
+				_multiplier = feature[1] & (HMOUSE_MULTIPLIER_WHEEL | HMOUSE_MULTIPLIER_PAN);
+			}
+			return true;
+		}
+	}
+
+	return false;
 }
 
 void HMouse_::begin(void) 
@@ -101,15 +226,70 @@ void HMouse_::click(uint8_t b)
 	move(0,0,0);
 }
 
-void HMouse_::move(int x, int y, int h = 0, int v = 0)
+void HMouse_::report(int x, int y, long wheel, long pan)
+{
+	int16_t w = limit_wheel(wheel);
+	int16_t p = limit_wheel(pan);
+	uint8_t m[8];
+	m[0] = HMOUSE_REPORT_ID;
+	m[1] = _buttons;
+	m[2] = limit_xy(x);
+	m[3] = limit_xy(y);
+	m[4] = lowByte(w);
+	m[5] = highByte(w);
+	m[6] = lowByte(p);
+	m[7] = highByte(p);
+	USB_Send(pluggedEndpoint | TRANSFER_RELEASE, m, sizeof(m));
+}
+
+void HMouse_::move(int x, int y, int wheel, int pan)
+{
+	long w = wheel;
+	long p = pan;
+	if (isHiRes(HMOUSE_MULTIPLIER_WHEEL)) {
+		w *= HMOUSE_HIRES_RESOLUTION;
+	}
+	if (isHiRes(HMOUSE_MULTIPLIER_PAN)) {
+		p *= HMOUSE_HIRES_RESOLUTION;
+	}
+	report(x, y, w, p);
+}
+
+void HMouse_::scrollHiRes(int wheel, int pan)
+{
+	send(_buttons, 0, 0, wheel, pan);
+}
+
+void HMouse_::send(uint8_t b, int x, int y, int wheel, int pan)
+{
+	long w = wheel;
+	long p = pan;
+	// Fallback for hosts that did not set the multiplier - send whole notches, keep the rest
+	if (!isHiRes(HMOUSE_MULTIPLIER_WHEEL)) {
+		w += _wheelRemainder;
+		_wheelRemainder = w % HMOUSE_HIRES_RESOLUTION;
+		w /= HMOUSE_HIRES_RESOLUTION;
+	}
+	if (!isHiRes(HMOUSE_MULTIPLIER_PAN)) {
+		p += _panRemainder;
+		_panRemainder = p % HMOUSE_HIRES_RESOLUTION;
+		p /= HMOUSE_HIRES_RESOLUTION;
+	}
+	if (w || p || x || y || (b != _buttons)) {
+		_buttons = b;
+		report(x, y, w, p);
+	}
+}
+
+bool HMouse_::ready(void)
+{
+	// USB_SendSpace() is 0 while the host did not take the previous report yet
+	return USB_SendSpace(pluggedEndpoint) >= 8;
+}
+
+bool HMouse_::isHiRes(uint8_t axis)
 {
-	uint8_t m[5];
-	m[0] = _buttons;
-	m[1] = limit_xy(x);
-	m[2] = limit_xy(y);
-	m[3] = limit_xy(h);
-	m[4] = limit_xy(v);
-	HID().SendReport(1,m,5);
+	return (_multiplier & axis) != 0;
 }
 
 void HMouse_::buttons(uint8_t b)
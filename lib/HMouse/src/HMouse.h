@@ -39,17 +39,42 @@
 #define MOUSE_MIDDLE 4
 #define MOUSE_ALL (MOUSE_LEFT | MOUSE_RIGHT | MOUSE_MIDDLE)
 
-class HMouse_
+// Units of scrollHiRes() per wheel notch, the value Windows and Linux use for high-resolution wheels
+#define HMOUSE_HIRES_RESOLUTION 120
+
+// Resolution Multiplier feature report bits, the host sets them to opt into high-resolution scrolling
+#define HMOUSE_MULTIPLIER_WHEEL 0x03
+#define HMOUSE_MULTIPLIER_PAN 0x0C
+
+// The mouse has its own HID interface (not the shared HID core) so it can answer the
+// Resolution Multiplier feature report. Until the host sets the multiplier, wheel and pan
+// are sent in whole notches.
+class HMouse_ : public PluggableUSBModule
 {
 private:
   uint8_t _buttons;
+  uint8_t _multiplier;
+  int16_t _wheelRemainder;
+  int16_t _panRemainder;
+  uint8_t _protocol;
+  uint8_t _idle;
+  EPTYPE_DESCRIPTOR_SIZE _epType[1];
   void buttons(uint8_t b);
+  void report(int x, int y, long wheel, long pan);
+protected:
+  int getInterface(uint8_t* interfaceCount);
+  int getDescriptor(USBSetup& setup);
+  bool setup(USBSetup& setup);
 public:
   HMouse_(void);
   void begin(void);
   void end(void);
   void click(uint8_t b = MOUSE_LEFT);
-  void move(int x, int y, int h = 0, int v = 0);
+  void move(int x, int y, int wheel = 0, int pan = 0); // wheel and pan in notches
+  void scrollHiRes(int wheel, int pan);   // wheel and pan in 1/HMOUSE_HIRES_RESOLUTION of a notch
+  void send(uint8_t b, int x, int y, int wheel, int pan); // whole report, wheel and pan as in scrollHiRes()
+  bool ready(void); // the endpoint takes a report without waiting for the host
+  bool isHiRes(uint8_t axis = HMOUSE_MULTIPLIER_WHEEL); // host enabled high-resolution for the axis
   void press(uint8_t b = MOUSE_LEFT);   // press LEFT by default
   void release(uint8_t b = MOUSE_LEFT); // release LEFT by default
   bool isPressed(uint8_t b = MOUSE_LEFT); // check LEFT by default
@@ -0,0 +1,181 @@
+/*
+  HRawHID.cpp
+
+  Copyright (c) 2015, Arduino LLC
+  Original code (pre-library): Copyright (c) 2011, Peter Barrett
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "HRawHID.h"
+
+#if defined(_USING_HID)
+
+#ifndef HID_REPORT_TYPE_OUTPUT
+#define HID_REPORT_TYPE_OUTPUT 2
+#endif
+
+static const uint8_t _hidReportDescriptor[] PROGMEM = {
+
+  //  Raw HID
+    0x06, lowByte(HRAWHID_USAGE_PAGE), highByte(HRAWHID_USAGE_PAGE), // USAGE_PAGE (Vendor Defined)
+    0x0a, lowByte(HRAWHID_USAGE), highByte(HRAWHID_USAGE),           // USAGE (Vendor Usage)
+    0xa1, 0x01,                    // COLLECTION (Application)
+    0x85, HRAWHID_REPORT_ID,       //   REPORT_ID (3)
+    0x15, 0x00,                    //   LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00,              //   LOGICAL_MAXIMUM (255)
+    0x75, 0x08,                    //   REPORT_SIZE (8)
+    0x95, HRAWHID_REPORT_SIZE,     //   REPORT_COUNT (63)
+    0x09, 0x01,                    //   USAGE (Vendor Usage 1)
+    0x81, 0x02,                    //   INPUT (Data,Var,Abs)
+    0x95, HRAWHID_REPORT_SIZE,     //   REPORT_COUNT (63)
+    0x09, 0x02,                    //   USAGE (Vendor Usage 2)
+    0x91, 0x02,                    //   OUTPUT (Data,Var,Abs)
+    0xc0,                          // END_COLLECTION
+};
+
+//================================================================================
+//================================================================================
+//	HRawHID
+
+HRawHID_::HRawHID_(void) : PluggableUSBModule(1, 1, _epType),
+	_available(false), _protocol(HID_REPORT_PROTOCOL), _idle(1)
+{
+	_epType[0] = EP_TYPE_INTERRUPT_IN;
+	PluggableUSB().plug(this);
+}
+
+int HRawHID_::getInterface(uint8_t* interfaceCount)
+{
+	*interfaceCount += 1; // uses 1
+	HIDDescriptor hidInterface = {
+		D_INTERFACE(pluggedInterface, 1, USB_DEVICE_CLASS_HUMAN_INTERFACE, HID_SUBCLASS_NONE, HID_PROTOCOL_NONE),
+		D_HIDREPORT(sizeof(_hidReportDescriptor)),
+		D_ENDPOINT(USB_ENDPOINT_IN(pluggedEndpoint), USB_ENDPOINT_TYPE_INTERRUPT, USB_EP_SIZE, 0x01)
+	};
+	return USB_SendControl(0, &hidInterface, sizeof(hidInterface));
+}
+
+int HRawHID_::getDescriptor(USBSetup& setup)
+{
+	// Check if this is a HID Class Descriptor request for our interface
+	if (setup.bmRequestType != REQUEST_DEVICETOHOST_STANDARD_INTERFACE) { return 0; }
+	if (setup.wValueH != HID_REPORT_DESCRIPTOR_TYPE) { return 0; }
+	if (setup.wIndex != pluggedInterface) { return 0; }
+
+	_protocol = HID_REPORT_PROTOCOL;
+	_available = false;
+
+	return USB_SendControl(TRANSFER_PGM, _hidReportDescriptor, sizeof(_hidReportDescriptor));
+}
+
+bool HRawHID_::setup(USBSetup& setup)
+{
+	if (pluggedInterface != setup.wIndex) {
+		return false;
+	}
+
+	uint8_t request = setup.bRequest;
+	uint8_t requestType = setup.bmRequestType;
+
+	if (requestType == REQUEST_DEVICETOHOST_CLASS_INTERFACE)
+	{
+		if (request == HID_GET_PROTOCOL) {
+			USB_SendControl(0, &_protocol, 1);
+			return true;
+		}
+		if (request == HID_GET_IDLE) {
+			USB_SendControl(0, &_idle, 1);
+			return true;
+		}
+	}
+
+	if (requestType == REQUEST_HOSTTODEVICE_CLASS_INTERFACE)
+	{
+		if (request == HID_SET_PROTOCOL) {
+			_protocol = setup.wValueL;
+			return true;
+		}
+		if (request == HID_SET_IDLE) {
+			_idle = setup.wValueL;
+			return true;
+		}
+		if ((request == HID_SET_REPORT) && (setup.wValueH == HID_REPORT_TYPE_OUTPUT)) {
+			// Stall while the previous report is not read, the host repeats the request
+			if (_available || (setup.wLength < 1) || (setup.wLength > HRAWHID_REPORT_SIZE + 1)) {
+				return false;
+			}
+			// Read in one call, USB_RecvControl() acknowledges every control packet it reads
+			uint8_t m[HRAWHID_REPORT_SIZE + 1] = {};
+			USB_RecvControl(m, setup.wLength);
+			if (m[0] != HRAWHID_REPORT_ID) {
+				return false;
+			}
+			memcpy(_data, m + 1, sizeof(_data));
+			_available = true;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void HRawHID_::begin(void)
+{
+}
+
+void HRawHID_::end(void)
+{
+}
+
+bool HRawHID_::available(void)
+{
+	return _available;
+}
+
+uint8_t HRawHID_::read(void* data, uint8_t length)
+{
+	if (!_available) {
+		return 0;
+	}
+	if (length > HRAWHID_REPORT_SIZE) {
+		length = HRAWHID_REPORT_SIZE;
+	}
+	memcpy(data, _data, length);
+	_available = false;
+	return length;
+}
+
+int HRawHID_::write(const void* data, uint8_t length)
+{
+	uint8_t m[HRAWHID_REPORT_SIZE + 1];
+	if (length > HRAWHID_REPORT_SIZE) {
+		length = HRAWHID_REPORT_SIZE;
+	}
+	m[0] = HRAWHID_REPORT_ID;
+	memcpy(m + 1, data, length);
+	memset(m + 1 + length, 0, HRAWHID_REPORT_SIZE - length);
+	return USB_Send(pluggedEndpoint | TRANSFER_RELEASE, m, sizeof(m));
+}
+
+bool HRawHID_::ready(void)
+{
+	// write() sends the report id and HRAWHID_REPORT_SIZE data bytes, a whole bank
+	return USB_SendSpace(pluggedEndpoint) >= HRAWHID_REPORT_SIZE + 1;
+}
+
+HRawHID_ HRawHID;
+
+#endif
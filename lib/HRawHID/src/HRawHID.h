@@ -0,0 +1,71 @@
+/*
+  HRawHID.h
+
+  Copyright (c) 2015, Arduino LLC
+  Original code (pre-library): Copyright (c) 2011, Peter Barrett
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef HRAWHID_h
+#define HRAWHID_h
+
+#include "HID.h"
+
+#if !defined(_USING_HID)
+
+#warning "Using legacy HID core (non pluggable)"
+
+#else
+
+//================================================================================
+//================================================================================
+//  Raw HID
+
+#define HRAWHID_REPORT_ID 3
+#define HRAWHID_REPORT_SIZE 63 // data bytes of the input and output report, without the report id
+
+#define HRAWHID_USAGE_PAGE 0xFFC0 // vendor defined, the same as HID-Project RawHID
+#define HRAWHID_USAGE 0x0C00
+
+// Raw HID interface with a single interrupt IN endpoint. After CDC, the HID core and HMouse only
+// one endpoint is left on the ATmega32U4, so the host sends its output reports as SET_REPORT
+// requests on the control endpoint (what Linux hidraw and Windows HidD_SetOutputReport do when
+// the interface has no OUT endpoint). One received report is kept until read().
+class HRawHID_ : public PluggableUSBModule
+{
+private:
+	uint8_t _data[HRAWHID_REPORT_SIZE];
+	volatile bool _available;
+	uint8_t _protocol;
+	uint8_t _idle;
+	EPTYPE_DESCRIPTOR_SIZE _epType[1];
+protected:
+	int getInterface(uint8_t* interfaceCount);
+	int getDescriptor(USBSetup& setup);
+	bool setup(USBSetup& setup);
+public:
+	HRawHID_(void);
+	void begin(void);
+	void end(void);
+	bool available(void); // an output report was received and not read yet
+	uint8_t read(void* data, uint8_t length); // copies the received report and frees it for the next one
+	int write(const void* data, uint8_t length); // sends one input report, the rest of it is zero
+	bool ready(void); // write() does not wait for the host
+};
+extern HRawHID_ HRawHID;
+
+#endif
+#endif
@@ -0,0 +1,49 @@
+/*
+  Arduino.h
+
+  Host stand-in for the Arduino AVR core, used by the native environment.
+  Time is simulated, see NativeHAL.h.
+*/
+
+#ifndef NATIVE_ARDUINO_h
+#define NATIVE_ARDUINO_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define PROGMEM
+#define PGM_P const char *
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define memcpy_P memcpy
+
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+
+typedef uint8_t byte;
+
+template <class T, class L, class H>
+inline T constrain(T amt, L low, H high) { return (amt < low) ? low : ((amt > high) ? high : amt); }
+
+// USB frame number, the simulated host sends start of frame every millisecond
+#define UDFNUML ((uint8_t)millis())
+
+uint32_t millis(void);
+uint32_t micros(void);
+void delay(uint32_t ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t val);
+
+#endif
@@ -0,0 +1,130 @@
+/*
+  HID-Project.h
+
+  Host stand-in for NicoHood's HID-Project: key code tables and the Keyboard,
+  Consumer and System devices, sending the same reports as the real library.
+*/
+
+#ifndef NATIVE_HID_PROJECT_h
+#define NATIVE_HID_PROJECT_h
+
+#include <HID.h>
+
+enum HID_REPORTID
+{
+  HID_REPORTID_NONE = 0,
+  HID_REPORTID_MOUSE = 1,
+  HID_REPORTID_KEYBOARD = 2,
+  HID_REPORTID_RAWHID = 3,
+  HID_REPORTID_CONSUMERCONTROL = 4,
+  HID_REPORTID_SYSTEMCONTROL = 5,
+};
+
+enum KeyboardKeycode : uint8_t
+{
+  KEY_RESERVED = 0,
+  KEY_A = 4, KEY_B, KEY_C, KEY_D, KEY_E, KEY_F, KEY_G, KEY_H, KEY_I, KEY_J, KEY_K, KEY_L, KEY_M,
+  KEY_N, KEY_O, KEY_P, KEY_Q, KEY_R, KEY_S, KEY_T, KEY_U, KEY_V, KEY_W, KEY_X, KEY_Y, KEY_Z,
+  KEY_1, KEY_2, KEY_3, KEY_4, KEY_5, KEY_6, KEY_7, KEY_8, KEY_9, KEY_0,
+  KEY_ENTER, KEY_ESC, KEY_BACKSPACE, KEY_TAB, KEY_SPACE, KEY_MINUS, KEY_EQUAL,
+  KEY_LEFT_BRACE, KEY_RIGHT_BRACE, KEY_BACKSLASH, KEY_NON_US_NUM, KEY_SEMICOLON, KEY_QUOTE,
+  KEY_TILDE, KEY_COMMA, KEY_PERIOD, KEY_SLASH, KEY_CAPS_LOCK,
+  KEY_F1, KEY_F2, KEY_F3, KEY_F4, KEY_F5, KEY_F6, KEY_F7, KEY_F8, KEY_F9, KEY_F10, KEY_F11, KEY_F12,
+  KEY_PRINTSCREEN, KEY_SCROLL_LOCK, KEY_PAUSE, KEY_INSERT, KEY_HOME, KEY_PAGE_UP, KEY_DELETE,
+  KEY_END, KEY_PAGE_DOWN, KEY_RIGHT_ARROW, KEY_LEFT_ARROW, KEY_DOWN_ARROW, KEY_UP_ARROW,
+  KEY_F13 = 0x68, KEY_F14, KEY_F15, KEY_F16, KEY_F17, KEY_F18, KEY_F19, KEY_F20, KEY_F21, KEY_F22, KEY_F23, KEY_F24,
+  KEY_LEFT_CTRL = 0xE0, KEY_LEFT_SHIFT, KEY_LEFT_ALT, KEY_LEFT_GUI,
+  KEY_RIGHT_CTRL, KEY_RIGHT_SHIFT, KEY_RIGHT_ALT, KEY_RIGHT_GUI,
+  KEY_LEFT_WINDOWS = KEY_LEFT_GUI,
+  KEY_RIGHT_WINDOWS = KEY_RIGHT_GUI,
+};
+
+enum ConsumerKeycode : uint16_t
+{
+  HID_CONSUMER_UNASSIGNED = 0x00,
+  CONSUMER_BRIGHTNESS_UP = 0x6F,
+  CONSUMER_BRIGHTNESS_DOWN = 0x70,
+  MEDIA_NEXT = 0xB5,
+  MEDIA_PREVIOUS = 0xB6,
+  MEDIA_STOP = 0xB7,
+  MEDIA_PLAY_PAUSE = 0xCD,
+  MEDIA_VOLUME_MUTE = 0xE2,
+  MEDIA_VOL_MUTE = MEDIA_VOLUME_MUTE,
+  MEDIA_VOLUME_UP = 0xE9,
+  MEDIA_VOL_UP = MEDIA_VOLUME_UP,
+  MEDIA_VOLUME_DOWN = 0xEA,
+  MEDIA_VOL_DOWN = MEDIA_VOLUME_DOWN,
+  CONSUMER_CALCULATOR = 0x192,
+};
+
+enum SystemKeycode : uint8_t
+{
+  SYSTEM_POWER_DOWN = 0x81,
+  SYSTEM_SLEEP = 0x82,
+  SYSTEM_WAKE_UP = 0x83,
+  HID_SYSTEM_SLEEP = SYSTEM_SLEEP,
+};
+
+typedef union
+{
+  uint8_t raw[8];
+  struct
+  {
+    uint8_t modifiers;
+    uint8_t reserved;
+    uint8_t keycodes[6];
+  };
+} HID_KeyboardReport_Data_t;
+
+typedef union
+{
+  uint16_t keys[4];
+} HID_ConsumerControlReport_Data_t;
+
+class Keyboard_
+{
+public:
+  void begin(void) {}
+  void end(void) {}
+  size_t write(KeyboardKeycode k);
+  size_t press(KeyboardKeycode k);
+  size_t release(KeyboardKeycode k);
+  void releaseAll(void);
+  size_t add(KeyboardKeycode k);
+  size_t remove(KeyboardKeycode k);
+  void removeAll(void);
+  int send(void);
+
+protected:
+  HID_KeyboardReport_Data_t _keyReport = {};
+};
+extern Keyboard_ Keyboard;
+
+class Consumer_
+{
+public:
+  void begin(void) {}
+  void end(void) {}
+  void write(ConsumerKeycode m);
+  void press(ConsumerKeycode m);
+  void release(ConsumerKeycode m);
+  void releaseAll(void);
+
+protected:
+  HID_ConsumerControlReport_Data_t _report = {};
+};
+extern Consumer_ Consumer;
+
+class System_
+{
+public:
+  void begin(void) {}
+  void end(void) {}
+  void write(SystemKeycode s);
+  void press(SystemKeycode s);
+  void release(void);
+  void releaseAll(void);
+};
+extern System_ System;
+
+#endif
@@ -0,0 +1,165 @@
+/*
+  HID.h
+
+  Host stand-in for the pluggable HID core and the PluggableUSB API of the
+  Arduino AVR core. Reports and control requests go through NativeHAL.
+*/
+
+#ifndef NATIVE_HID_h
+#define NATIVE_HID_h
+
+#include <Arduino.h>
+
+#define _USING_HID
+
+//================================================================================
+//  PluggableUSB
+
+#define USB_EP_SIZE 64
+#define USB_ENDPOINTS 7
+
+#define TRANSFER_PGM 0x80
+#define TRANSFER_RELEASE 0x40
+#define TRANSFER_ZERO 0x20
+
+#define EPTYPE_DESCRIPTOR_SIZE uint8_t
+#define EP_TYPE_INTERRUPT_IN 0xC1
+#define EP_TYPE_INTERRUPT_OUT 0xC0
+
+#define REQUEST_HOSTTODEVICE_CLASS_INTERFACE 0x21
+#define REQUEST_DEVICETOHOST_CLASS_INTERFACE 0xA1
+#define REQUEST_DEVICETOHOST_STANDARD_INTERFACE 0x81
+
+#define USB_DEVICE_CLASS_HUMAN_INTERFACE 0x03
+#define USB_ENDPOINT_IN(addr) (lowByte((addr) | 0x80))
+#define USB_ENDPOINT_OUT(addr) (lowByte((addr) | 0x00))
+#define USB_ENDPOINT_TYPE_INTERRUPT 0x03
+
+typedef struct
+{
+  uint8_t bmRequestType;
+  uint8_t bRequest;
+  uint8_t wValueL;
+  uint8_t wValueH;
+  uint16_t wIndex;
+  uint16_t wLength;
+} USBSetup;
+
+typedef struct
+{
+  uint8_t len, dtype, number, alternate, numEndpoints, interfaceClass, interfaceSubClass, protocol, iInterface;
+} InterfaceDescriptor;
+
+typedef struct
+{
+  uint8_t len, dtype, addr, attr;
+  uint16_t packetSize;
+  uint8_t interval;
+} __attribute__((packed)) EndpointDescriptor;
+
+#define D_INTERFACE(_n, _numEndpoints, _class, _subClass, _protocol) \
+  { 9, 4, _n, 0, _numEndpoints, _class, _subClass, _protocol, 0 }
+#define D_ENDPOINT(_addr, _attr, _packetSize, _interval) \
+  { 7, 5, _addr, _attr, _packetSize, _interval }
+
+class PluggableUSBModule
+{
+public:
+  PluggableUSBModule(uint8_t numEps, uint8_t numIfs, EPTYPE_DESCRIPTOR_SIZE *epType)
+    : numEndpoints(numEps), numInterfaces(numIfs), endpointType(epType) {}
+
+protected:
+  virtual bool setup(USBSetup &setup) = 0;
+  virtual int getInterface(uint8_t *interfaceCount) = 0;
+  virtual int getDescriptor(USBSetup &setup) = 0;
+  virtual uint8_t getShortName(char *name) { name[0] = 'A' + pluggedInterface; return 1; }
+
+  uint8_t pluggedInterface;
+  uint8_t pluggedEndpoint;
+
+  const uint8_t numEndpoints;
+  const uint8_t numInterfaces;
+  const EPTYPE_DESCRIPTOR_SIZE *endpointType;
+
+  PluggableUSBModule *next = NULL;
+
+  friend class PluggableUSB_;
+};
+
+class PluggableUSB_
+{
+public:
+  bool plug(PluggableUSBModule *node);
+  bool setup(USBSetup &setup);
+  int getDescriptor(USBSetup &setup);
+
+private:
+  uint8_t lastIf = 2; // CDC uses interfaces 0 and 1
+  uint8_t lastEp = 4; // and endpoints 1 - 3
+  PluggableUSBModule *rootNode = NULL;
+};
+
+PluggableUSB_ &PluggableUSB();
+
+int USB_SendControl(uint8_t flags, const void *d, int len);
+int USB_RecvControl(void *d, int len);
+int USB_Send(uint8_t ep, const void *data, int len);
+int USB_SendSpace(uint8_t ep);
+
+//================================================================================
+//  HID
+
+#define HID_GET_REPORT 0x01
+#define HID_GET_IDLE 0x02
+#define HID_GET_PROTOCOL 0x03
+#define HID_SET_REPORT 0x09
+#define HID_SET_IDLE 0x0A
+#define HID_SET_PROTOCOL 0x0B
+
+#define HID_HID_DESCRIPTOR_TYPE 0x21
+#define HID_REPORT_DESCRIPTOR_TYPE 0x22
+
+#define HID_SUBCLASS_NONE 0
+#define HID_PROTOCOL_NONE 0
+
+#define HID_BOOT_PROTOCOL 0
+#define HID_REPORT_PROTOCOL 1
+
+#define HID_REPORT_TYPE_INPUT 1
+#define HID_REPORT_TYPE_OUTPUT 2
+#define HID_REPORT_TYPE_FEATURE 3
+
+typedef struct
+{
+  uint8_t len, dtype, addr, versionL, versionH, country, desctype, descLenL, descLenH;
+} HIDDescDescriptor;
+
+typedef struct
+{
+  InterfaceDescriptor hid;
+  HIDDescDescriptor desc;
+  EndpointDescriptor in;
+} HIDDescriptor;
+
+#define D_HIDREPORT(length) { 9, 0x21, 0x01, 0x01, 0, 1, 0x22, lowByte(length), highByte(length) }
+
+class HIDSubDescriptor
+{
+public:
+  HIDSubDescriptor(const void *d, const uint16_t l) : data(d), length(l) {}
+  const void *data;
+  const uint16_t length;
+};
+
+class HID_
+{
+public:
+  void AppendDescriptor(HIDSubDescriptor *node) { (void)node; }
+  int SendReport(uint8_t id, const void *data, int len);
+protected:
+  uint8_t pluggedEndpoint = 0;
+};
+
+HID_ &HID();
+
+#endif
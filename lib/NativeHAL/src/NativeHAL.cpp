@@ -0,0 +1,824 @@
+/*
+  NativeHAL.cpp
+
+  Simulated clock, pins and USB reports of the native environment.
+*/
+
+#include <vector>
+#include <HID-Project.h>
+#include <avr/eeprom.h>
+#include "NativeHAL.h"
+
+volatile uint8_t PINB = 0xFF, PINC = 0xFF, PIND = 0xFF, PINE = 0xFF, PINF = 0xFF;
+volatile uint8_t DDRB, DDRC, DDRD, DDRE, DDRF;
+volatile uint8_t PORTB, PORTC, PORTD, PORTE, PORTF;
+volatile uint8_t EICRA, EICRB, EIMSK, EIFR, PCICR, PCIFR, PCMSK0;
+volatile uint8_t SREG;
+volatile uint8_t TCCR3A, TCCR3B, TIMSK3, TIFR3;
+volatile uint16_t TCNT3;
+volatile uint8_t TWBR, TWSR, TWDR, TWAR;
+volatile uint8_t SPCR, SPSR;
+static void twiWritten();
+static void spiWritten();
+TNativeStrobe TWCR = {0, twiWritten};
+TNativeStrobe SPDR = {0, spiWritten};
+
+static uint32_t sleeps;
+
+static uint64_t nowUs;
+static void matrixSettle();
+static std::vector<TNativeReport> reports;
+static bool endpointFull[USB_ENDPOINTS];
+static uint32_t endpointFrame[USB_ENDPOINTS]; // millis() of the last report, the host takes it in the next frame
+
+HID_ &HID()
+{
+  static HID_ obj;
+  return obj;
+}
+
+Keyboard_ Keyboard;
+Consumer_ Consumer;
+System_ System;
+
+//================================================================================
+//  Pins - digital pin to port mapping of the Leonardo / Pro Micro variant
+
+static volatile uint8_t *pinPort(uint8_t pin, uint8_t *bit)
+{
+  static const struct { char port; uint8_t bit; } map[] = {
+    {'D', 2}, {'D', 3}, {'D', 1}, {'D', 0}, {'D', 4}, {'C', 6}, {'D', 7}, {'E', 6},
+    {'B', 4}, {'B', 5}, {'B', 6}, {'B', 7}, {'D', 6}, {'C', 7}, {'B', 3}, {'B', 1},
+    {'B', 2}, {'B', 0}, {'F', 7}, {'F', 6}, {'F', 5}, {'F', 4}, {'F', 1}, {'F', 0},
+  };
+  if (pin >= sizeof(map) / sizeof(map[0])) {
+    return 0;
+  }
+  *bit = map[pin].bit;
+  switch (map[pin].port) {
+    case 'B': return &PINB;
+    case 'C': return &PINC;
+    case 'D': return &PIND;
+    case 'E': return &PINE;
+    default: return &PINF;
+  }
+}
+
+// Vectors the firmware does not define
+extern "C" {
+__attribute__((weak)) void PCINT0_vect(void) {}
+__attribute__((weak)) void INT0_vect(void) {}
+__attribute__((weak)) void INT1_vect(void) {}
+__attribute__((weak)) void INT2_vect(void) {}
+__attribute__((weak)) void INT3_vect(void) {}
+__attribute__((weak)) void INT6_vect(void) {}
+__attribute__((weak)) void TIMER3_OVF_vect(void) {}
+__attribute__((weak)) void TWI_vect(void) {}
+__attribute__((weak)) void SPI_STC_vect(void) {}
+}
+
+// Runs the interrupt enabled for the changed pin (any edge)
+static void pinInterrupt(volatile uint8_t *port, uint8_t bit)
+{
+  if ((port == &PINB) && (PCICR & _BV(PCIE0)) && (PCMSK0 & _BV(bit))) {
+    PCINT0_vect();
+  }
+  else if ((port == &PIND) && (bit <= 3) && (EIMSK & _BV(bit))) {
+    static void (*const vectors[])(void) = {INT0_vect, INT1_vect, INT2_vect, INT3_vect};
+    vectors[bit]();
+  }
+  else if ((port == &PINE) && (bit == 6) && (EIMSK & _BV(6))) {
+    INT6_vect();
+  }
+}
+
+void nativeSetPin(uint8_t pin, uint8_t level)
+{
+  uint8_t bit;
+  volatile uint8_t *port = pinPort(pin, &bit);
+  if (!port) {
+    return;
+  }
+  uint8_t old = *port;
+  if (level) {
+    *port |= (1 << bit);
+  } else {
+    *port &= ~(1 << bit);
+  }
+  if (*port != old) {
+    pinInterrupt(port, bit);
+  }
+}
+
+// Pin is an output driven low
+static bool pinDrivenLow(uint8_t pin)
+{
+  uint8_t bit;
+  volatile uint8_t *port = pinPort(pin, &bit);
+  volatile uint8_t *ddr = (port == &PINB) ? &DDRB : (port == &PINC) ? &DDRC : (port == &PIND) ? &DDRD : (port == &PINE) ? &DDRE : &DDRF;
+  volatile uint8_t *out = (port == &PINB) ? &PORTB : (port == &PINC) ? &PORTC : (port == &PIND) ? &PORTD : (port == &PINE) ? &PORTE : &PORTF;
+  return (port) && (*ddr & (1 << bit)) && (!(*out & (1 << bit)));
+}
+
+//================================================================================
+//  Key matrix
+
+static struct {
+  const uint8_t *rowPin;
+  const uint8_t *colPin;
+  uint8_t rows;
+  uint8_t cols;
+  bool diodes;
+  uint64_t pressed; // bit row * cols + col
+} matrix;
+
+void nativeMatrix(const uint8_t *rowPins, uint8_t rows, const uint8_t *colPins, uint8_t cols, bool diodes)
+{
+  for (uint8_t r = 0; r < matrix.rows; r++) {
+    nativeSetPin(matrix.rowPin[r], HIGH);
+  }
+  for (uint8_t c = 0; c < matrix.cols; c++) {
+    nativeSetPin(matrix.colPin[c], HIGH);
+  }
+  matrix = {rowPins, colPins, rows, cols, diodes, 0};
+  matrixSettle();
+}
+
+void nativeSetMatrixKey(uint8_t row, uint8_t col, bool pressed)
+{
+  uint64_t bit = (uint64_t)1 << (row * matrix.cols + col);
+  matrix.pressed = pressed ? (matrix.pressed | bit) : (matrix.pressed & ~bit);
+  matrixSettle();
+}
+
+// Spreads the low level of the driven columns through the pressed keys
+static void matrixSettle()
+{
+  uint32_t lowRows = 0, lowCols = 0;
+  for (uint8_t c = 0; c < matrix.cols; c++) {
+    lowCols |= pinDrivenLow(matrix.colPin[c]) ? (1UL << c) : 0;
+  }
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (uint8_t r = 0; r < matrix.rows; r++) {
+      for (uint8_t c = 0; c < matrix.cols; c++) {
+        if (!(matrix.pressed & ((uint64_t)1 << (r * matrix.cols + c)))) {
+          continue;
+        }
+        if ((lowCols & (1UL << c)) && (!(lowRows & (1UL << r)))) {
+          lowRows |= 1UL << r;
+          changed = true;
+        }
+        if ((!matrix.diodes) && (lowRows & (1UL << r)) && (!(lowCols & (1UL << c)))) {
+          lowCols |= 1UL << c;
+          changed = true;
+        }
+      }
+    }
+  }
+  for (uint8_t r = 0; r < matrix.rows; r++) {
+    nativeSetPin(matrix.rowPin[r], (lowRows & (1UL << r)) ? LOW : HIGH);
+  }
+  for (uint8_t c = 0; c < matrix.cols; c++) {
+    nativeSetPin(matrix.colPin[c], (lowCols & (1UL << c)) ? LOW : HIGH);
+  }
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  (void)pin;
+  (void)mode;
+}
+
+int digitalRead(uint8_t pin)
+{
+  uint8_t bit;
+  volatile uint8_t *port = pinPort(pin, &bit);
+  return (port && (*port & (1 << bit))) ? HIGH : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  nativeSetPin(pin, val);
+}
+
+//================================================================================
+//  Port expanders - MCP23017 on the TWI, a 74HC165 chain on the SPI
+
+#define MCP23017_ADDRESS 0x20
+#define MCP23017_REGISTERS 0x16
+#define MCP23017_IPOLA 0x02
+#define MCP23017_GPIOA 0x12
+#define MCP23017_GPIOB 0x13
+
+enum TTwiState {
+  TWI_IDLE,
+  TWI_STARTED,  // START sent, the next byte is the address
+  TWI_WRITING,  // addressed for writing, the first byte is the register
+  TWI_READING,
+};
+
+static struct {
+  uint8_t mcp23017;        // chips on the TWI
+  uint8_t shiftRegisters;  // chips in the SPI chain
+  uint8_t loadPin;
+  uint16_t pressed[8];     // bit per input of every chip
+  uint8_t reg[8][MCP23017_REGISTERS];
+  uint8_t pointer[8];      // register address of the next byte
+  uint64_t latched;        // 74HC165 chain, byte 0 shifts out first
+  uint32_t bytes;          // moved on either bus
+} expanders;
+
+static enum TTwiState twiState;
+static int8_t twiChip = -1; // addressed chip, -1 none
+static uint8_t twiFirst;    // next written byte is the register address
+
+static void shiftLoad();
+static bool busBusy;
+static bool busIsTwi;
+static uint64_t busDoneNs;
+static uint64_t busIsrNs; // end of the transfer whose interrupt runs, 0 outside of it
+
+void nativeExpanders(uint8_t mcp23017, uint8_t shiftRegisters, uint8_t loadPin)
+{
+  memset(&expanders, 0, sizeof(expanders));
+  expanders.mcp23017 = (mcp23017 < 8) ? mcp23017 : 8;
+  expanders.shiftRegisters = (shiftRegisters < 8) ? shiftRegisters : 8;
+  expanders.loadPin = loadPin;
+  twiState = TWI_IDLE;
+  twiChip = -1;
+}
+
+void nativeSetExpanderKey(uint8_t chip, uint8_t input, bool pressed)
+{
+  uint16_t bit = 1 << input;
+  expanders.pressed[chip & 7] = pressed ? (expanders.pressed[chip & 7] | bit) : (expanders.pressed[chip & 7] & ~bit);
+  shiftLoad();
+}
+
+uint32_t nativeExpanderBytes()
+{
+  return expanders.bytes;
+}
+
+// Next transfer ends after the cycles, counted from the end of the last one inside its interrupt
+static void busStart(bool twi, uint64_t cycles)
+{
+  uint64_t startNs = busIsrNs ? busIsrNs : nowUs * 1000;
+  busBusy = true;
+  busIsTwi = twi;
+  busDoneNs = startNs + cycles * 1000000000ULL / F_CPU;
+}
+
+// Pin levels of a MCP23017 port, pull-ups or not a released key reads high
+static uint8_t mcpRead(uint8_t chip)
+{
+  uint8_t address = expanders.pointer[chip];
+  uint8_t value = expanders.reg[chip][address];
+  if ((address == MCP23017_GPIOA) || (address == MCP23017_GPIOB)) {
+    uint8_t port = address - MCP23017_GPIOA;
+    value = (uint8_t)~(expanders.pressed[chip] >> (8 * port)) ^ expanders.reg[chip][MCP23017_IPOLA + port];
+  }
+  expanders.pointer[chip] = (address + 1) % MCP23017_REGISTERS;
+  return value;
+}
+
+static void mcpWrite(uint8_t chip, uint8_t value)
+{
+  if (twiFirst) {
+    expanders.pointer[chip] = value % MCP23017_REGISTERS;
+    twiFirst = 0;
+    return;
+  }
+  expanders.reg[chip][expanders.pointer[chip]] = value;
+  expanders.pointer[chip] = (expanders.pointer[chip] + 1) % MCP23017_REGISTERS;
+}
+
+// Writing TWCR with TWINT set clears the flag and starts the bus event the other bits ask for
+static void twiWritten()
+{
+  uint8_t control = TWCR.value;
+  if ((!(control & _BV(TWEN))) || (!(control & _BV(TWINT)))) {
+    return;
+  }
+  TWCR.value &= ~(_BV(TWINT) | _BV(TWSTO));
+  uint64_t bitCycles = 16 + 2 * (uint64_t)TWBR * (1 << (2 * (TWSR & 3)));
+  if (control & _BV(TWSTO)) {
+    twiState = TWI_IDLE;
+    twiChip = -1;
+    if (!(control & _BV(TWSTA))) {
+      return;
+    }
+  }
+  if (control & _BV(TWSTA)) {
+    TWSR = (TWSR & 3) | ((twiState == TWI_IDLE) ? 0x08 : 0x10);
+    twiState = TWI_STARTED;
+    busStart(true, bitCycles * ((control & _BV(TWSTO)) ? 2 : 1));
+    return;
+  }
+  uint8_t status;
+  if (twiState == TWI_STARTED) {
+    uint8_t address = TWDR >> 1;
+    bool read = TWDR & 1;
+    twiChip = ((address >= MCP23017_ADDRESS) && (address < MCP23017_ADDRESS + expanders.mcp23017)) ? address - MCP23017_ADDRESS : -1;
+    twiState = read ? TWI_READING : TWI_WRITING;
+    twiFirst = 1;
+    status = read ? ((twiChip >= 0) ? 0x40 : 0x48) : ((twiChip >= 0) ? 0x18 : 0x20);
+  }
+  else if ((twiState == TWI_WRITING) && (twiChip >= 0)) {
+    mcpWrite(twiChip, TWDR);
+    status = 0x28;
+  }
+  else if ((twiState == TWI_READING) && (twiChip >= 0)) {
+    TWDR = mcpRead(twiChip);
+    status = (control & _BV(TWEA)) ? 0x50 : 0x58;
+  }
+  else {
+    status = 0x30; // nobody listens
+  }
+  TWSR = (TWSR & 3) | status;
+  expanders.bytes++;
+  busStart(true, bitCycles * 9);
+}
+
+// 74HC165 chain: loads its inputs while the load pin is low, shifts a byte per SPI transfer after
+static void shiftLoad()
+{
+  if ((!expanders.shiftRegisters) || (!pinDrivenLow(expanders.loadPin))) {
+    return;
+  }
+  expanders.latched = ~(uint64_t)0;
+  for (uint8_t i = 0; i < expanders.shiftRegisters; i++) {
+    expanders.latched &= ~((uint64_t)(expanders.pressed[i] & 0xFF) << (8 * i));
+  }
+}
+
+static void spiWritten()
+{
+  static const uint8_t divider[4] = {4, 16, 64, 128};
+  if ((!(SPCR & _BV(SPE))) || (!(SPCR & _BV(MSTR)))) {
+    return;
+  }
+  SPSR &= ~_BV(SPIF);
+  expanders.bytes++;
+  busStart(false, 8 * (uint64_t)divider[SPCR & 3] / ((SPSR & _BV(SPI2X)) ? 2 : 1));
+}
+
+// Ends the running transfer and runs its interrupt
+static void busDone()
+{
+  busBusy = false;
+  busIsrNs = busDoneNs;
+  if (busIsTwi) {
+    TWCR.value |= _BV(TWINT);
+    if (TWCR.value & _BV(TWIE)) {
+      TWI_vect();
+    }
+  } else {
+    bool loading = pinDrivenLow(expanders.loadPin);
+    SPDR.value = loading ? ((expanders.latched & 1) ? 0xFF : 0x00) : (uint8_t)expanders.latched;
+    if (!loading) {
+      expanders.latched = (expanders.latched >> 8) | ((uint64_t)0xFF << 56); // SER of the last chip high
+    }
+    SPSR |= _BV(SPIF);
+    if (SPCR & _BV(SPIE)) {
+      SPSR &= ~_BV(SPIF);
+      SPI_STC_vect();
+    }
+  }
+  busIsrNs = 0;
+}
+
+//================================================================================
+//  Time
+
+uint32_t millis(void)
+{
+  return (uint32_t)(nowUs / 1000);
+}
+
+uint32_t micros(void)
+{
+  return (uint32_t)nowUs;
+}
+
+// Timer3 without prescaler counts CPU cycles, overflows run its interrupt or set the flag
+static void timer3Advance(uint64_t us)
+{
+  if (!(TCCR3B & _BV(CS30))) {
+    return;
+  }
+  uint64_t count = TCNT3 + us * (F_CPU / 1000000);
+  TCNT3 = (uint16_t)count;
+  for (uint64_t overflows = count >> 16; overflows > 0; overflows--) {
+    if (TIMSK3 & _BV(TOIE3)) {
+      TIMER3_OVF_vect();
+    } else {
+      TIFR3 |= _BV(TOV3);
+    }
+  }
+}
+
+void nativeAdvanceUs(uint32_t us)
+{
+  uint64_t endUs = nowUs + us;
+  // bus transfers ending meanwhile run their interrupt at their time, it may start the next one
+  while ((busBusy) && (busDoneNs <= endUs * 1000)) {
+    uint64_t doneUs = (busDoneNs + 999) / 1000;
+    timer3Advance(doneUs - nowUs);
+    nowUs = doneUs;
+    busDone();
+  }
+  timer3Advance(endUs - nowUs);
+  nowUs = endUs;
+  matrixSettle();
+  shiftLoad();
+}
+
+void delay(uint32_t ms)
+{
+  nativeAdvanceUs(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  nativeAdvanceUs(us);
+}
+
+void nativeSleep(void)
+{
+  sleeps++;
+}
+
+uint32_t nativeSleepCount()
+{
+  return sleeps;
+}
+
+void nativeReset()
+{
+  nowUs = 0;
+  PINB = PINC = PIND = PINE = PINF = 0xFF;
+  reports.clear();
+  memset(endpointFull, 0, sizeof(endpointFull));
+  nativeEepromErase();
+}
+
+//================================================================================
+//  EEPROM
+
+#define EEPROM_WRITE_US 3400
+
+static uint8_t eeprom[E2END + 1];
+static uint64_t eepromReadyUs;
+static uint32_t eepromWrites;
+
+static void eepromWait(void)
+{
+  if (eepromReadyUs > nowUs) {
+    nativeAdvanceUs((uint32_t)(eepromReadyUs - nowUs));
+  }
+}
+
+bool nativeEepromReady(void)
+{
+  return eepromReadyUs <= nowUs;
+}
+
+uint8_t eeprom_read_byte(const uint8_t *p)
+{
+  eepromWait();
+  return eeprom[(uintptr_t)p & E2END];
+}
+
+void eeprom_write_byte(uint8_t *p, uint8_t value)
+{
+  eepromWait();
+  eeprom[(uintptr_t)p & E2END] = value;
+  eepromReadyUs = nowUs + EEPROM_WRITE_US;
+  eepromWrites++;
+}
+
+void eeprom_update_byte(uint8_t *p, uint8_t value)
+{
+  if (eeprom_read_byte(p) != value) {
+    eeprom_write_byte(p, value);
+  }
+}
+
+void eeprom_read_block(void *dst, const void *src, size_t n)
+{
+  for (size_t i = 0; i < n; i++) {
+    ((uint8_t *)dst)[i] = eeprom_read_byte((const uint8_t *)src + i);
+  }
+}
+
+uint32_t nativeEepromWrites()
+{
+  return eepromWrites;
+}
+
+void nativeEepromErase()
+{
+  memset(eeprom, 0xFF, sizeof(eeprom));
+  eepromReadyUs = 0;
+}
+
+//================================================================================
+//  PluggableUSB
+
+static const uint8_t *controlOut;  // data stage of the simulated host to device request
+static int controlOutLength;
+static uint8_t controlIn[NATIVE_MAX_REPORT];
+static int controlInLength;
+
+PluggableUSB_ &PluggableUSB()
+{
+  static PluggableUSB_ obj;
+  return obj;
+}
+
+bool PluggableUSB_::plug(PluggableUSBModule *node)
+{
+  if ((lastEp + node->numEndpoints) > USB_ENDPOINTS) {
+    return false;
+  }
+  node->pluggedInterface = lastIf;
+  node->pluggedEndpoint = lastEp;
+  lastIf += node->numInterfaces;
+  lastEp += node->numEndpoints;
+  node->next = rootNode;
+  rootNode = node;
+  return true;
+}
+
+bool PluggableUSB_::setup(USBSetup &setup)
+{
+  for (PluggableUSBModule *node = rootNode; node; node = node->next) {
+    if (node->setup(setup)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int PluggableUSB_::getDescriptor(USBSetup &setup)
+{
+  for (PluggableUSBModule *node = rootNode; node; node = node->next) {
+    int ret = node->getDescriptor(setup);
+    if (ret) {
+      return ret;
+    }
+  }
+  return 0;
+}
+
+int USB_SendControl(uint8_t flags, const void *d, int len)
+{
+  (void)flags;
+  int space = NATIVE_MAX_REPORT - controlInLength;
+  int count = (len < space) ? len : space;
+  memcpy(controlIn + controlInLength, d, count);
+  controlInLength += count;
+  return len;
+}
+
+int USB_RecvControl(void *d, int len)
+{
+  int count = (len < controlOutLength) ? len : controlOutLength;
+  memcpy(d, controlOut, count);
+  controlOut += count;
+  controlOutLength -= count;
+  return count;
+}
+
+// The host polls every IN endpoint once per frame (1 ms), a report fills the bank of its
+// endpoint until then. The HID core stands on endpoint 0 here, it is not plugged.
+static bool endpointBusy(uint8_t ep)
+{
+  ep &= 0x07;
+  return endpointFull[ep] && (endpointFrame[ep] == millis());
+}
+
+// Fills the bank, a full one blocks until the host takes it like USB_Send() of the core
+static void endpointFill(uint8_t ep)
+{
+  ep &= 0x07;
+  if (endpointBusy(ep)) {
+    nativeAdvanceUs(1000 - nowUs % 1000);
+  }
+  endpointFull[ep] = true;
+  endpointFrame[ep] = millis();
+}
+
+int USB_Send(uint8_t ep, const void *data, int len)
+{
+  // plugged modules send the report id as the first byte
+  endpointFill(ep);
+  TNativeReport report;
+  report.timeUs = (uint32_t)nowUs;
+  report.id = ((const uint8_t *)data)[0];
+  report.length = (len - 1 > NATIVE_MAX_REPORT) ? NATIVE_MAX_REPORT : len - 1;
+  memcpy(report.data, (const uint8_t *)data + 1, report.length);
+  reports.push_back(report);
+  return len;
+}
+
+int USB_SendSpace(uint8_t ep)
+{
+  // a free bank takes a whole packet, USB_Send() of the core follows a full one with a zero length packet
+  return endpointBusy(ep) ? 0 : USB_EP_SIZE;
+}
+
+// Offers the request to every interface, as the host addresses the one with the report
+static bool nativeControl(USBSetup &setup)
+{
+  for (uint16_t iface = 0; iface < 16; iface++) {
+    setup.wIndex = iface;
+    if (PluggableUSB().setup(setup)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool nativeSetReport(uint8_t type, const void *data, uint8_t length)
+{
+  USBSetup setup = {REQUEST_HOSTTODEVICE_CLASS_INTERFACE, HID_SET_REPORT, ((const uint8_t *)data)[0], type, 0, length};
+  controlOut = (const uint8_t *)data;
+  controlOutLength = length;
+  return nativeControl(setup);
+}
+
+int nativeGetReport(uint8_t type, uint8_t id, void *data, uint8_t length)
+{
+  USBSetup setup = {REQUEST_DEVICETOHOST_CLASS_INTERFACE, HID_GET_REPORT, id, type, 0, length};
+  controlInLength = 0;
+  if (!nativeControl(setup)) {
+    return -1;
+  }
+  int count = (length < controlInLength) ? length : controlInLength;
+  memcpy(data, controlIn, count);
+  return count;
+}
+
+//================================================================================
+//  USB reports
+
+int HID_::SendReport(uint8_t id, const void *data, int len)
+{
+  endpointFill(pluggedEndpoint);
+  TNativeReport report;
+  report.timeUs = (uint32_t)nowUs;
+  report.id = id;
+  report.length = (len > NATIVE_MAX_REPORT) ? NATIVE_MAX_REPORT : len;
+  memcpy(report.data, data, report.length);
+  reports.push_back(report);
+  return len + 1;
+}
+
+uint32_t nativeReportCount()
+{
+  return reports.size();
+}
+
+const TNativeReport *nativeReport(uint32_t index)
+{
+  return (index < reports.size()) ? &reports[index] : 0;
+}
+
+void nativeClearReports()
+{
+  reports.clear();
+}
+
+//================================================================================
+//  HID-Project devices
+
+size_t Keyboard_::write(KeyboardKeycode k)
+{
+  press(k);
+  release(k);
+  return 1;
+}
+
+size_t Keyboard_::press(KeyboardKeycode k)
+{
+  add(k);
+  send();
+  return 1;
+}
+
+size_t Keyboard_::release(KeyboardKeycode k)
+{
+  remove(k);
+  send();
+  return 1;
+}
+
+void Keyboard_::releaseAll(void)
+{
+  removeAll();
+  send();
+}
+
+size_t Keyboard_::add(KeyboardKeycode k)
+{
+  if ((k >= KEY_LEFT_CTRL) && (k <= KEY_RIGHT_GUI)) {
+    _keyReport.modifiers |= (1 << (k - KEY_LEFT_CTRL));
+    return 1;
+  }
+  for (uint8_t i = 0; i < sizeof(_keyReport.keycodes); i++) {
+    if (_keyReport.keycodes[i] == k) {
+      return 1;
+    }
+  }
+  for (uint8_t i = 0; i < sizeof(_keyReport.keycodes); i++) {
+    if (_keyReport.keycodes[i] == KEY_RESERVED) {
+      _keyReport.keycodes[i] = k;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+size_t Keyboard_::remove(KeyboardKeycode k)
+{
+  if ((k >= KEY_LEFT_CTRL) && (k <= KEY_RIGHT_GUI)) {
+    _keyReport.modifiers &= ~(1 << (k - KEY_LEFT_CTRL));
+    return 1;
+  }
+  for (uint8_t i = 0; i < sizeof(_keyReport.keycodes); i++) {
+    if (_keyReport.keycodes[i] == k) {
+      _keyReport.keycodes[i] = KEY_RESERVED;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void Keyboard_::removeAll(void)
+{
+  memset(&_keyReport, 0, sizeof(_keyReport));
+}
+
+int Keyboard_::send(void)
+{
+  return HID().SendReport(HID_REPORTID_KEYBOARD, &_keyReport, sizeof(_keyReport));
+}
+
+void Consumer_::write(ConsumerKeycode m)
+{
+  press(m);
+  release(m);
+}
+
+void Consumer_::press(ConsumerKeycode m)
+{
+  for (uint8_t i = 0; i < 4; i++) {
+    if (_report.keys[i] == HID_CONSUMER_UNASSIGNED) {
+      _report.keys[i] = m;
+      break;
+    }
+  }
+  HID().SendReport(HID_REPORTID_CONSUMERCONTROL, &_report, sizeof(_report));
+}
+
+void Consumer_::release(ConsumerKeycode m)
+{
+  for (uint8_t i = 0; i < 4; i++) {
+    if (_report.keys[i] == m) {
+      _report.keys[i] = HID_CONSUMER_UNASSIGNED;
+    }
+  }
+  HID().SendReport(HID_REPORTID_CONSUMERCONTROL, &_report, sizeof(_report));
+}
+
+void Consumer_::releaseAll(void)
+{
+  memset(&_report, 0, sizeof(_report));
+  HID().SendReport(HID_REPORTID_CONSUMERCONTROL, &_report, sizeof(_report));
+}
+
+void System_::write(SystemKeycode s)
+{
+  press(s);
+  release();
+}
+
+void System_::press(SystemKeycode s)
+{
+  uint8_t report = s;
+  HID().SendReport(HID_REPORTID_SYSTEMCONTROL, &report, sizeof(report));
+}
+
+void System_::release(void)
+{
+  uint8_t report = 0;
+  HID().SendReport(HID_REPORTID_SYSTEMCONTROL, &report, sizeof(report));
+}
+
+void System_::releaseAll(void)
+{
+  release();
+}
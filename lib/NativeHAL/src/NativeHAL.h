@@ -0,0 +1,57 @@
+/*
+  NativeHAL.h
+
+  Simulation interface of the native environment. The firmware runs against
+  a simulated clock which only moves when nativeAdvanceUs() is called, so
+  timing results do not depend on the speed of the host.
+*/
+
+#ifndef NATIVEHAL_h
+#define NATIVEHAL_h
+
+#include <Arduino.h>
+
+#define NATIVE_MAX_REPORT 64
+
+typedef struct TNativeReports {
+  uint32_t timeUs;
+  uint8_t id;
+  uint8_t length;
+  uint8_t data[NATIVE_MAX_REPORT];
+} TNativeReport;
+
+// Firmware entry points
+void setup();
+void loop();
+
+void nativeReset();                        // clock to zero, all pins released, report log cleared, EEPROM erased
+void nativeAdvanceUs(uint32_t us);         // move the simulated clock, runs the Timer3 overflow interrupt
+void nativeSetPin(uint8_t pin, uint8_t level); // runs the pin interrupt if it is enabled
+uint32_t nativeSleepCount();               // times the firmware entered sleep
+
+// Key switches between row and column pins, the row and column levels follow the columns driven
+// low (DDRx and PORTx) when the clock moves, like lines settling. Without diodes a key also
+// passes the low level from its row back to its column. rows 0 removes the matrix.
+void nativeMatrix(const uint8_t *rowPins, uint8_t rows, const uint8_t *colPins, uint8_t cols, bool diodes);
+void nativeSetMatrixKey(uint8_t row, uint8_t col, bool pressed);
+
+// MCP23017 chips on the TWI at I2C address 0x20 and up and a chain of 74HC165 shift registers on
+// the SPI, loading their inputs while loadPin is driven low. A transfer ends after its bus time and
+// then runs the TWI or SPI interrupt. Keys pull the inputs low, input 0 - 7 is GPIOA of a MCP23017
+// or input A - H of a 74HC165, 8 - 15 GPIOB. 0 chips removes them.
+void nativeExpanders(uint8_t mcp23017, uint8_t shiftRegisters, uint8_t loadPin);
+void nativeSetExpanderKey(uint8_t chip, uint8_t input, bool pressed);
+uint32_t nativeExpanderBytes();            // bytes moved on either bus
+
+// Control requests of the simulated host, data of the reports starts with the report id
+bool nativeSetReport(uint8_t type, const void *data, uint8_t length);
+int nativeGetReport(uint8_t type, uint8_t id, void *data, uint8_t length);
+
+uint32_t nativeEepromWrites();             // bytes programmed since start, unchanged bytes skipped by the firmware do not count
+void nativeEepromErase();                  // all bytes 0xFF as a new chip
+
+uint32_t nativeReportCount();
+const TNativeReport *nativeReport(uint32_t index);
+void nativeClearReports();
+
+#endif
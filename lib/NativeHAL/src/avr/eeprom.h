@@ -0,0 +1,26 @@
+/*
+  avr/eeprom.h
+
+  Host stand-in for the EEPROM of the ATmega32U4. A write keeps the EEPROM
+  busy for 3.4 ms of simulated time, reads and writes wait for it like
+  avr-libc does.
+*/
+
+#ifndef NATIVE_AVR_EEPROM_h
+#define NATIVE_AVR_EEPROM_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define E2END 0x3FF
+
+bool nativeEepromReady(void);
+
+#define eeprom_is_ready() nativeEepromReady()
+
+uint8_t eeprom_read_byte(const uint8_t *p);
+void eeprom_write_byte(uint8_t *p, uint8_t value);
+void eeprom_update_byte(uint8_t *p, uint8_t value);
+void eeprom_read_block(void *dst, const void *src, size_t n);
+
+#endif
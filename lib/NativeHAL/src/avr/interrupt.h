@@ -0,0 +1,29 @@
+/*
+  avr/interrupt.h
+
+  Host stand-in: interrupt vectors are plain functions, NativeHAL calls them
+  when a simulated pin with the interrupt enabled changes or a bus transfer
+  ends.
+*/
+
+#ifndef NATIVE_AVR_INTERRUPT_h
+#define NATIVE_AVR_INTERRUPT_h
+
+#define cli()
+#define sei()
+
+#define ISR(vector) extern "C" void vector(void)
+
+extern "C" {
+void PCINT0_vect(void);
+void INT0_vect(void);
+void INT1_vect(void);
+void INT2_vect(void);
+void INT3_vect(void);
+void INT6_vect(void);
+void TIMER3_OVF_vect(void);
+void TWI_vect(void);
+void SPI_STC_vect(void);
+}
+
+#endif
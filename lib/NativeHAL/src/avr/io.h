@@ -0,0 +1,90 @@
+/*
+  avr/io.h
+
+  Host stand-in for the ATmega32U4 registers used by the firmware.
+*/
+
+#ifndef NATIVE_AVR_IO_h
+#define NATIVE_AVR_IO_h
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+// Port input, direction and output registers
+extern volatile uint8_t PINB, PINC, PIND, PINE, PINF;
+extern volatile uint8_t DDRB, DDRC, DDRD, DDRE, DDRF;
+extern volatile uint8_t PORTB, PORTC, PORTD, PORTE, PORTF;
+
+// External and pin change interrupts
+extern volatile uint8_t EICRA, EICRB, EIMSK, EIFR, PCICR, PCIFR, PCMSK0;
+
+#define ISC00 0
+#define ISC01 1
+#define ISC10 2
+#define ISC11 3
+#define ISC20 4
+#define ISC21 5
+#define ISC30 6
+#define ISC31 7
+#define ISC60 4
+#define ISC61 5
+#define PCIE0 0
+#define PCIF0 0
+
+// Status register, only saved and restored around cli()
+extern volatile uint8_t SREG;
+
+// Timer3 counts simulated time at F_CPU when started without prescaler, see nativeAdvanceUs()
+extern volatile uint8_t TCCR3A, TCCR3B, TIMSK3, TIFR3;
+extern volatile uint16_t TCNT3;
+
+// Registers whose write starts a bus transfer call the simulated bus, see NativeHAL.cpp
+struct TNativeStrobe {
+  volatile uint8_t value;
+  void (*written)(void);
+
+  operator uint8_t() const { return value; }
+  TNativeStrobe &operator=(uint8_t v) {
+    value = v;
+    written();
+    return *this;
+  }
+};
+
+// Two-wire interface, TWCR starts the next bus event (see nativeExpanders())
+extern volatile uint8_t TWBR, TWSR, TWDR, TWAR;
+extern TNativeStrobe TWCR;
+
+#define TWINT 7
+#define TWEA 6
+#define TWSTA 5
+#define TWSTO 4
+#define TWWC 3
+#define TWEN 2
+#define TWIE 0
+#define TWPS1 1
+#define TWPS0 0
+
+// SPI, SPDR starts a byte transfer
+extern volatile uint8_t SPCR, SPSR;
+extern TNativeStrobe SPDR;
+
+#define SPIE 7
+#define SPE 6
+#define DORD 5
+#define MSTR 4
+#define CPOL 3
+#define CPHA 2
+#define SPR1 1
+#define SPR0 0
+#define SPIF 7
+#define WCOL 6
+#define SPI2X 0
+
+#define F_CPU 16000000UL
+#define CS30 0
+#define TOIE3 0
+#define TOV3 0
+
+#endif
@@ -0,0 +1,19 @@
+/*
+  avr/sleep.h
+
+  Host stand-in: sleeping only counts, the simulation decides what happens next.
+*/
+
+#ifndef NATIVE_AVR_SLEEP_h
+#define NATIVE_AVR_SLEEP_h
+
+#define SLEEP_MODE_IDLE 0
+
+void nativeSleep(void);
+
+#define set_sleep_mode(mode)
+#define sleep_enable()
+#define sleep_disable()
+#define sleep_cpu() nativeSleep()
+
+#endif
@@ -0,0 +1,20 @@
+/*
+  util/crc16.h
+
+  Host stand-in for the CRC helpers of avr-libc, same results as the
+  optimized assembler versions.
+*/
+
+#ifndef NATIVE_UTIL_CRC16_h
+#define NATIVE_UTIL_CRC16_h
+
+#include <stdint.h>
+
+static inline uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data)
+{
+  data ^= crc & 0xff;
+  data ^= data << 4;
+  return ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3));
+}
+
+#endif
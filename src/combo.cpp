@@ -0,0 +1,88 @@
+#include "combo.h"
+
+#define ALL_COMBOS ((uint32_t)(((uint64_t)1 << NUMBER_OF_COMBOS) - 1))
+
+static constexpr TComboTable table = comboTable();
+static constexpr TKeyMask members = comboMemberKeys();
+
+static TKeyMask last;     // debounced keys of the last call
+static TKeyMask waiting;  // keys held back
+static TKeyMask through;  // keys passed through after being held back, still down
+static TKeyMask tapped;   // keys released while held back, down for this pass
+static TKeyMask consumed; // keys of combos that went down, still down
+static TKeyMask active;   // combos down
+static uint32_t waitMs;   // first key held back
+
+static void release(TKeyMask up) {
+  for (uint8_t i = 0; i < NUMBER_OF_COMBOS; i++) {
+    if ((active & ((TKeyMask)1 << (NUMBER_OF_KEYS + i))) && (up & comboKeys[i])) {
+      active &= ~((TKeyMask)1 << (NUMBER_OF_KEYS + i));
+    }
+  }
+}
+
+// The combo whose keys are exactly the held back keys, NUMBER_OF_COMBOS if none. more: a bigger
+// combo can still form.
+static uint8_t match(uint32_t possible, bool *more) {
+  uint8_t found = NUMBER_OF_COMBOS;
+  for (uint8_t i = 0; i < NUMBER_OF_COMBOS; i++) {
+    if (possible & ((uint32_t)1 << i)) {
+      if (comboKeys[i] == waiting) {
+        found = i;
+      } else {
+        *more = true;
+      }
+    }
+  }
+  return found;
+}
+
+void comboBegin() {
+  last = waiting = through = tapped = consumed = active = 0;
+}
+
+TKeyMask combo(TKeyMask pressed, uint32_t now) {
+  TKeyMask down = pressed & ~last;
+  TKeyMask up = last & ~pressed;
+  last = pressed;
+  tapped = 0;
+  if (up & consumed) {
+    release(up);
+  }
+  consumed &= pressed;
+  through &= pressed;
+
+  if (down & members) {
+    if (!waiting) {
+      waitMs = now;
+    }
+    waiting |= down & members;
+  }
+  if (waiting) {
+    uint32_t possible = ALL_COMBOS;
+    for (uint8_t i = 0; i < NUMBER_OF_KEYS; i++) {
+      if (waiting & ((TKeyMask)1 << i)) {
+        possible &= table.ofKey[i];
+      }
+    }
+    bool more = false;
+    uint8_t found = match(possible, &more);
+    bool term = (now - waitMs) >= COMBO_TERM_MS;
+    if ((found < NUMBER_OF_COMBOS) && ((!more) || (term)) && (!(up & waiting))) {
+      active |= (TKeyMask)1 << (NUMBER_OF_KEYS + found);
+      consumed |= waiting;
+      waiting = 0;
+    }
+    else if ((term) || (!possible) || (up & waiting) || (down & ~members)) {
+      // no combo, the keys go down late and a released one stays down for this pass
+      through |= waiting & pressed;
+      tapped = waiting & ~pressed;
+      waiting = 0;
+    }
+  }
+  return (pressed & ~members) | through | tapped | active;
+}
+
+bool comboBusy() {
+  return (waiting) || (tapped);
+}
@@ -0,0 +1,219 @@
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+#include <HRawHID.h>
+#include "config.h"
+#include "macro.h"
+#include "stats.h"
+#include "stream.h"
+
+#define CONFIG_MAGIC 0x4B4D // 'KM' - the header is valid
+
+#define SLOT_ADDRESS(slot) (CONFIG_EEPROM_SLOTS + (slot) * KEYMAP_MAX_SIZE)
+#define EEPROM_PTR(address) ((uint8_t *)(uintptr_t)(address))
+
+static_assert(SLOT_ADDRESS(2) <= E2END + 1, "two keymap slots do not fit into EEPROM");
+static_assert(sizeof(TConfigPacket) <= HRAWHID_REPORT_SIZE, "configuration packet does not fit into the Raw HID report");
+
+typedef struct TConfigHeaders {
+  uint16_t magic;
+  uint8_t format; // KEYMAP_FORMAT of the keymap
+  uint8_t slot;  // slot with the keymap in use
+  uint16_t size; // bytes of the keymap
+  uint16_t crc;  // of the keymap
+} TConfigHeader;
+
+static TConfigHeader header;    // copy of the header in EEPROM
+static TConfigPacket packet;    // request being served, then its reply
+static bool replyPending;       // packet holds a request not answered yet
+static bool loadPending;        // the header changed, the keymap cache follows before the reply
+
+// Page programmed in the background, a byte takes 3.4 ms
+static uint8_t page[CONFIG_PAGE_SIZE];
+static uint16_t pageAddress;
+static uint8_t pageLength, pagePos;
+
+static bool headerValid() {
+  return (header.magic == CONFIG_MAGIC) && (header.format == KEYMAP_FORMAT);
+}
+
+// Slot for the next upload
+static uint8_t stagingSlot() {
+  return headerValid() ? !header.slot : 0;
+}
+
+static void pageWrite(uint16_t address, const void *data, uint8_t length) {
+  memcpy(page, data, length);
+  pageAddress = address;
+  pageLength = length;
+  pagePos = 0;
+}
+
+// Programs the next byte that differs, if the EEPROM is not busy with the previous one
+static void pageRun() {
+  while ((pagePos < pageLength) && (eeprom_is_ready())) {
+    uint8_t *address = EEPROM_PTR(pageAddress + pagePos);
+    uint8_t value = page[pagePos++];
+    if (eeprom_read_byte(address) != value) {
+      eeprom_write_byte(address, value);
+      return;
+    }
+  }
+}
+
+static uint16_t eepromCrc(uint16_t address, uint16_t length) {
+  uint16_t crc = 0xFFFF;
+  for (uint16_t i = 0; i < length; i++) {
+    crc = _crc_ccitt_update(crc, eeprom_read_byte(EEPROM_PTR(address + i)));
+  }
+  return crc;
+}
+
+static uint16_t cacheCrc() {
+  uint16_t crc = 0xFFFF;
+  for (uint16_t i = 0; i < macroCacheSize; i++) {
+    crc = _crc_ccitt_update(crc, macroCache[i]);
+  }
+  return crc;
+}
+
+// The slot passes the checks of keymap[] at compile time, bytes after the last binding are never read
+static bool slotValid(uint16_t address, uint16_t size) {
+  enum TKeymapCheck check = keymapCheck([address](uint16_t pos) { return eeprom_read_byte(EEPROM_PTR(address + pos)); }, size);
+  return (check == KEYMAP_OK) || (check == KEYMAP_TRAILING_BYTES);
+}
+
+static void load() {
+  if (headerValid()) {
+    eeprom_read_block(macroCache, EEPROM_PTR(SLOT_ADDRESS(header.slot)), header.size);
+    macroCacheSize = header.size;
+    macroBind();
+  } else {
+    macroBegin();
+  }
+}
+
+// Handles the request in packet, leaves the reply there
+static void serve() {
+  uint16_t offset = packet.offset;
+  uint16_t length = packet.length;
+  packet.status = CONFIG_OK;
+  switch (packet.command) {
+    case CONFIG_INFO: {
+      TConfigInfo info = {CONFIG_VERSION, (uint8_t)(headerValid() ? CONFIG_SOURCE_EEPROM : CONFIG_SOURCE_FIRMWARE),
+                          NUMBER_OF_KEYS, CONFIG_PAGE_SIZE, KEYMAP_MAX_SIZE, NUMBER_OF_LAYERS, NUMBER_OF_BINDINGS};
+      packet.length = macroCacheSize;
+      packet.crc = cacheCrc();
+      memcpy(packet.data, &info, sizeof(info));
+      break;
+    }
+    case CONFIG_READ:
+      if ((length > CONFIG_PAGE_SIZE) || (offset > macroCacheSize) || (offset + length > macroCacheSize)) {
+        packet.status = CONFIG_ERROR_RANGE;
+        break;
+      }
+      memcpy(packet.data, macroCache + offset, length);
+      break;
+    case CONFIG_WRITE:
+      if ((length > CONFIG_PAGE_SIZE) || (offset > KEYMAP_MAX_SIZE) || (offset + length > KEYMAP_MAX_SIZE)) {
+        packet.status = CONFIG_ERROR_RANGE;
+        break;
+      }
+      pageWrite(SLOT_ADDRESS(stagingSlot()) + offset, packet.data, length);
+      break;
+    case CONFIG_CHECKSUM:
+      if (length > KEYMAP_MAX_SIZE) {
+        packet.status = CONFIG_ERROR_RANGE;
+        break;
+      }
+      packet.crc = eepromCrc(SLOT_ADDRESS(stagingSlot()), length);
+      break;
+    case CONFIG_COMMIT:
+      if ((length == 0) || (length > KEYMAP_MAX_SIZE)) {
+        packet.status = CONFIG_ERROR_RANGE;
+      }
+      else if (eepromCrc(SLOT_ADDRESS(stagingSlot()), length) != packet.crc) {
+        packet.status = CONFIG_ERROR_CHECKSUM;
+      }
+      else if (!slotValid(SLOT_ADDRESS(stagingSlot()), length)) {
+        packet.status = CONFIG_ERROR_KEYMAP;
+      }
+      else {
+        header = {CONFIG_MAGIC, KEYMAP_FORMAT, stagingSlot(), length, packet.crc};
+        pageWrite(CONFIG_EEPROM_HEADER, &header, sizeof(header));
+        loadPending = true;
+      }
+      break;
+    case CONFIG_FACTORY:
+      header.magic = 0;
+      pageWrite(CONFIG_EEPROM_HEADER, &header, sizeof(header));
+      loadPending = true;
+      break;
+#ifdef STATS
+    case CONFIG_STATS:
+      if ((length > CONFIG_PAGE_SIZE) || (offset > sizeof(TConfigStats)) || (offset + length > sizeof(TConfigStats))) {
+        packet.status = CONFIG_ERROR_RANGE;
+        break;
+      }
+      statsRead(offset, length, packet.data);
+      break;
+    case CONFIG_STATS_CLEAR:
+      statsClear();
+      break;
+#endif
+    case CONFIG_TYPE:
+      if ((length > CONFIG_PAGE_SIZE) || (length % 2) || (!streamWrite(packet.data, length / 2))) {
+        packet.status = CONFIG_ERROR_RANGE;
+      }
+      packet.offset = streamFree();
+      packet.length = streamPending();
+      break;
+    default:
+      packet.status = CONFIG_ERROR_COMMAND;
+      break;
+  }
+}
+
+void configBegin() {
+  HRawHID.begin();
+  eeprom_read_block(&header, EEPROM_PTR(CONFIG_EEPROM_HEADER), sizeof(header));
+  if (headerValid()) {
+    if ((header.slot > 1) || (header.size == 0) || (header.size > KEYMAP_MAX_SIZE) ||
+        (eepromCrc(SLOT_ADDRESS(header.slot), header.size) != header.crc) ||
+        (!slotValid(SLOT_ADDRESS(header.slot), header.size))) {
+      header.magic = 0; // interrupted commit, older format or another firmware's data, keep keymap[]
+    }
+  }
+  load();
+}
+
+void configRun(bool busy) {
+  if (!replyPending) {
+    if (!HRawHID.available()) {
+      return;
+    }
+    HRawHID.read(&packet, sizeof(packet));
+    serve();
+    replyPending = true;
+  }
+  // reading EEPROM waits for the write in progress, so the reply and loading wait for it here
+  pageRun();
+  if ((pagePos < pageLength) || (!eeprom_is_ready())) {
+    return;
+  }
+  if (loadPending) {
+    if (busy) {
+      return; // playing sequences point into the keymap in use
+    }
+    load();
+    loadPending = false;
+  }
+  if (!HRawHID.ready()) {
+    return; // the host did not read the previous reply yet, USB_Send() would wait for it
+  }
+  HRawHID.write(&packet, sizeof(packet));
+  replyPending = false;
+}
+
+bool configBusy() {
+  return replyPending;
+}
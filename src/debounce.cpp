@@ -0,0 +1,69 @@
+#include "debounce.h"
+
+static TKeyMask state;                  // debounced state
+static TKeyMask counter[DEBOUNCE_BITS]; // bit planes of the per key millisecond counters
+static TKeyMask eagerMask;
+static TKeyMask lastRaw;
+static uint32_t lastMs;
+
+static_assert(DEBOUNCING_MS > 0, "DEBOUNCING_MS must be at least 1 ms");
+
+// One millisecond sample of all keys
+static void sample(TKeyMask raw) {
+  TKeyMask differ = raw ^ state;
+  TKeyMask carry = differ;
+  TKeyMask reached = differ;
+  for (uint8_t bit = 0; bit < DEBOUNCE_BITS; bit++) {
+    TKeyMask plane = counter[bit] & differ; // keys that agree start from zero again
+    counter[bit] = plane ^ carry;
+    carry &= plane;
+    reached &= (DEBOUNCING_MS & (1 << bit)) ? counter[bit] : ~counter[bit];
+  }
+  state ^= reached;
+  for (uint8_t bit = 0; bit < DEBOUNCE_BITS; bit++) {
+    counter[bit] &= ~reached;
+  }
+}
+
+void debounceBegin(TKeyMask eager) {
+  state = 0;
+  for (uint8_t bit = 0; bit < DEBOUNCE_BITS; bit++) {
+    counter[bit] = 0;
+  }
+  eagerMask = eager;
+  lastRaw = 0;
+  lastMs = millis();
+}
+
+TKeyMask debounce(TKeyMask raw, uint32_t now) {
+  // presses of eager keys count right away
+  TKeyMask press = raw & ~state & eagerMask;
+  if (press) {
+    state |= press;
+    for (uint8_t bit = 0; bit < DEBOUNCE_BITS; bit++) {
+      counter[bit] &= ~press;
+    }
+  }
+  // one sample per millisecond, milliseconds without a pass (sleep) keep the last seen state
+  uint32_t elapsed = now - lastMs;
+  if (elapsed > DEBOUNCING_MS) {
+    elapsed = DEBOUNCING_MS;
+  }
+  lastMs = now;
+  if (elapsed) {
+    while (--elapsed) {
+      sample(lastRaw);
+    }
+    sample(raw);
+  }
+  lastRaw = raw;
+  return state;
+}
+
+bool debounceBusy() {
+  TKeyMask pending = 0;
+  for (uint8_t bit = 0; bit < DEBOUNCE_BITS; bit++) {
+    pending |= counter[bit];
+  }
+  return pending != 0;
+}
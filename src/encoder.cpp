@@ -0,0 +1,133 @@
+#include <HID-Project.h>
+#include <HMouse.h>
+#include "encoder.h"
+#include "hidqueue.h"
+#include "report.h"
+#include "stats.h"
+
+#define HIRES_PER_STEP (HMOUSE_HIRES_RESOLUTION / ENCODER_STEPS_PER_NOTCH)
+
+static int16_t pendingWheel; // in 1/HMOUSE_HIRES_RESOLUTION of a notch
+static int16_t pendingPan;
+static int16_t pendingVolume; // in detents
+static ConsumerKeycode pressedVolume;
+
+// Rotation of an encoder
+typedef struct TEncoderStates {
+  int8_t direction;        // of the rotation the rate is measured for
+  uint32_t lastMoveMs;
+  uint32_t rateStartMs;    // start of the detent being measured
+  uint8_t rateSteps;       // steps since rateStartMs
+  uint16_t rate;           // detents per second
+  int8_t scaleRemainder;   // fraction of a step in 1/ENCODER_CURVE_ONE
+  enum TEncoderAction lastAction;
+  int8_t notchSteps;       // steps of volume or bindings not making a whole detent yet
+  int8_t detents;          // detents of ENCODER_BINDINGS not played yet
+} TEncoderState;
+
+static TEncoderState state[NUMBER_OF_ENCODERS];
+
+// Adds to the pending wheel or pan, steps beyond the report range are lost
+static int16_t addScroll(int16_t pending, int16_t steps) {
+  long wanted = (long)pending + (long)steps * HIRES_PER_STEP;
+  int16_t kept = constrain(wanted, -32767, 32767);
+  statsCount(STATS_ENCODER_DROPPED, labs(wanted - kept) / HIRES_PER_STEP);
+  return kept;
+}
+
+// Adds whole detents to the pending ones, up to the limit, the rest of the steps waits in notchSteps
+static int16_t addDetents(TEncoderState *e, int16_t pending, int16_t steps, int16_t limit) {
+  int16_t total = e->notchSteps + steps;
+  int16_t wanted = pending + total / ENCODER_STEPS_PER_NOTCH;
+  e->notchSteps = total % ENCODER_STEPS_PER_NOTCH;
+  int16_t kept = constrain(wanted, -limit, limit);
+  statsCount(STATS_ENCODER_DROPPED, abs(wanted - kept) * ENCODER_STEPS_PER_NOTCH);
+  return kept;
+}
+
+// Measures the rotation speed, every whole detent updates it
+static void measureRate(TEncoderState *e, enum TEncoderAction action, int16_t steps, uint32_t now) {
+  int8_t dir = (steps > 0) ? 1 : -1;
+  if ((dir != e->direction) || (action != e->lastAction) || ((now - e->lastMoveMs) >= ENCODER_RATE_RESET_MS)) {
+    e->direction = dir;
+    e->lastAction = action;
+    e->rate = 0;
+    e->rateSteps = 0;
+    e->rateStartMs = now;
+    e->scaleRemainder = 0;
+  }
+  e->lastMoveMs = now;
+  e->rateSteps = constrain(e->rateSteps + abs(steps), 0, 255);
+  if ((e->rateSteps >= ENCODER_STEPS_PER_NOTCH) && (now != e->rateStartMs)) {
+    e->rate = constrain((uint32_t)e->rateSteps * 1000 / ENCODER_STEPS_PER_NOTCH / (now - e->rateStartMs), 0UL, 0xFFFFUL);
+    e->rateSteps = 0;
+    e->rateStartMs = now;
+  }
+}
+
+// Steps times the gain of the curve at the measured rate
+static int16_t accelerate(TEncoderState *e, enum TEncoderCurve curve, int16_t steps) {
+  uint8_t point = constrain(e->rate / ENCODER_CURVE_RATE_STEP, 0, ENCODER_CURVE_POINTS - 1);
+  long scaled = (long)steps * pgm_read_byte(&encoderCurve[curve][point]) + e->scaleRemainder;
+  long result = scaled / ENCODER_CURVE_ONE;
+  e->scaleRemainder = scaled - result * ENCODER_CURVE_ONE;
+  return constrain(result, -32767, 32767);
+}
+
+void encoderAdd(uint8_t encoder, enum TEncoderAction action, enum TEncoderCurve curve, int16_t steps, uint32_t now) {
+  TEncoderState *e = &state[encoder];
+  measureRate(e, action, steps, now);
+  steps = accelerate(e, curve, steps);
+  if (action == ENCODER_WHEEL) {
+    pendingWheel = addScroll(pendingWheel, steps);
+  }
+  else if (action == ENCODER_PAN) {
+    pendingPan = addScroll(pendingPan, steps);
+  }
+  else if (action == ENCODER_VOLUME) {
+    pendingVolume = addDetents(e, pendingVolume, steps, ENCODER_MAX_VOLUME_STEPS);
+  }
+  else if (action == ENCODER_BINDINGS) {
+    e->detents = addDetents(e, e->detents, steps, ENCODER_MAX_DETENTS);
+  }
+}
+
+int8_t encoderDetent(uint8_t encoder) {
+  return (state[encoder].detents > 0) ? 1 : (state[encoder].detents < 0) ? -1 : 0;
+}
+
+void encoderDetentDone(uint8_t encoder) {
+  state[encoder].detents -= encoderDetent(encoder);
+}
+
+void encoderFlush() {
+  if ((pendingWheel) || (pendingPan)) {
+    uint16_t steps = (abs(pendingWheel) + abs(pendingPan)) / HIRES_PER_STEP;
+    statsCount(STATS_ENCODER_COALESCED, steps - 1);
+    reportMouseScroll(pendingWheel, pendingPan);
+    pendingWheel = 0;
+    pendingPan = 0;
+  }
+
+  if (!hidQueueEmpty(HID_QUEUE_CONSUMER)) {
+    return; // one volume press or release per consumer report
+  }
+  if (pressedVolume) {
+    reportConsumerRelease(pressedVolume);
+    pressedVolume = HID_CONSUMER_UNASSIGNED;
+  }
+  else if (pendingVolume) {
+    pressedVolume = (pendingVolume > 0) ? MEDIA_VOLUME_UP : MEDIA_VOLUME_DOWN;
+    pendingVolume += (pendingVolume > 0) ? -1 : 1;
+    reportConsumerPress(pressedVolume);
+  }
+}
+
+bool encoderBusy() {
+  for (uint8_t i = 0; i < NUMBER_OF_ENCODERS; i++) {
+    if (state[i].detents) {
+      return true;
+    }
+  }
+  return (pendingWheel) || (pendingPan) || (pendingVolume) || (pressedVolume);
+}
@@ -0,0 +1,170 @@
+#include "expander.h"
+#include <avr/interrupt.h>
+#include <util/twi.h>
+
+// MCP23017 registers with IOCON.BANK = 0, the address pointer moves on after every byte
+#define MCP_IPOLA 0x02
+#define MCP_GPPUA 0x0C
+#define MCP_GPIOA 0x12
+
+#define MCP_READ 2 // transfer of a chip after its set up
+
+// Register writes of the set up of a MCP23017: register, then the A and B values
+static const uint8_t mcpSetup[MCP_READ][3] = {
+  {MCP_IPOLA, 0xFF, 0xFF}, // pressed key reads 1
+  {MCP_GPPUA, 0xFF, 0xFF}, // pull-ups on
+};
+
+static uint8_t type, chips;
+static volatile bool running;
+static volatile uint64_t keys;
+static volatile uint16_t reads;
+
+// Read running, used by the interrupt only
+static uint64_t next;      // keys read so far
+static uint8_t chip;       // being read
+static uint8_t step;       // transfer of the chip, 0 to MCP_READ
+static uint8_t sent;       // bytes of the transfer sent after the address
+static uint8_t configured; // bit per MCP23017 set up since it last answered
+
+static void readDone() {
+  keys = next;
+  reads++;
+  running = false;
+}
+
+static inline void twiCommand(uint8_t bits) {
+  TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE) | bits;
+}
+
+// First transfer of the chip, its set up unless it is set up. stop: TWSTO ends the transfer
+// before, or 0 for the first chip of the read.
+static void mcpChip(uint8_t stop) {
+  sent = 0;
+  if (chip < chips) {
+    step = (configured & (1 << chip)) ? MCP_READ : 0;
+    twiCommand(stop | _BV(TWSTA));
+  } else {
+    TWCR = _BV(TWINT) | _BV(TWEN) | stop;
+    readDone();
+  }
+}
+
+ISR(TWI_vect) {
+  uint8_t address = (EXPANDER_MCP23017_ADDRESS + chip) << 1;
+  switch (TW_STATUS) {
+    case TW_START:
+      TWDR = address | TW_WRITE;
+      twiCommand(0);
+      break;
+    case TW_REP_START:
+      TWDR = address | TW_READ;
+      twiCommand(0);
+      break;
+    case TW_MT_SLA_ACK:
+    case TW_MT_DATA_ACK:
+      if (step < MCP_READ) {
+        if (sent < sizeof(mcpSetup[0])) {
+          TWDR = mcpSetup[step][sent++];
+          twiCommand(0);
+        } else {
+          step++;
+          sent = 0;
+          twiCommand(_BV(TWSTO) | _BV(TWSTA));
+        }
+      }
+      else if (!sent) {
+        TWDR = MCP_GPIOA;
+        sent++;
+        twiCommand(0);
+      } else {
+        twiCommand(_BV(TWSTA));
+      }
+      break;
+    case TW_MR_SLA_ACK:
+      twiCommand(_BV(TWEA)); // GPIOA acknowledged, GPIOB not as the last byte
+      break;
+    case TW_MR_DATA_ACK:
+      next |= (uint64_t)TWDR << (16 * chip);
+      twiCommand(0);
+      break;
+    case TW_MR_DATA_NACK:
+      next |= (uint64_t)TWDR << (16 * chip + 8);
+      configured |= 1 << chip;
+      chip++;
+      mcpChip(_BV(TWSTO));
+      break;
+    default:
+      // no answer or the bus lost, the chip reads as no key pressed
+      configured &= ~(1 << chip);
+      chip++;
+      mcpChip(_BV(TWSTO));
+      break;
+  }
+}
+
+ISR(SPI_STC_vect) {
+  next |= (uint64_t)(uint8_t)~SPDR << (8 * chip);
+  if (++chip < chips) {
+    SPDR = 0;
+  } else {
+    pinOutput(EXPANDER_LOAD_PIN, false);
+    readDone();
+  }
+}
+
+void expanderBegin(uint8_t newType, uint8_t newChips) {
+  TWCR = 0;
+  SPCR = 0;
+  type = newType;
+  chips = (newChips < expanderMaxChips(type)) ? newChips : expanderMaxChips(type);
+  running = false;
+  keys = 0;
+  configured = 0;
+  if (type == EXPANDER_MCP23017) {
+    pinMode(EXPANDER_SDA_PIN, INPUT);
+    pinMode(EXPANDER_SCL_PIN, INPUT);
+    TWSR = 0; // prescaler 1
+    TWBR = (F_CPU / EXPANDER_I2C_HZ - 16) / 2;
+    TWCR = _BV(TWEN);
+  }
+  else if (type == EXPANDER_74HC165) {
+    pinOutput(EXPANDER_SS_PIN, true);
+    pinOutput(EXPANDER_SCK_PIN, false);
+    pinMode(EXPANDER_MISO_PIN, INPUT);
+    pinOutput(EXPANDER_LOAD_PIN, false);
+    SPSR = _BV(SPI2X); // F_CPU / 2
+    SPCR = _BV(SPIE) | _BV(SPE) | _BV(MSTR);
+  }
+}
+
+void expanderStart() {
+  if ((type == EXPANDER_NONE) || (!chips) || (running)) {
+    return;
+  }
+  running = true;
+  next = 0;
+  chip = 0;
+  if (type == EXPANDER_MCP23017) {
+    mcpChip(0);
+  } else {
+    pinOutput(EXPANDER_LOAD_PIN, true); // inputs latched, the chain shifts
+    SPDR = 0;
+  }
+}
+
+uint64_t expanderKeys() {
+  uint64_t last;
+  cli();
+  last = keys;
+  sei();
+  return last;
+}
+
+uint16_t expanderReads() {
+  uint16_t count;
+  cli();
+  count = reads;
+  sei();
+  return count;
+}
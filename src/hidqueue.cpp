@@ -0,0 +1,179 @@
+#include <HCore.h>
+#include <HID-Project.h>
+#include <HMouse.h>
+#include "hidqueue.h"
+#include "stats.h"
+#include "usbframe.h"
+
+static_assert((HID_QUEUE_SIZE >= 2) && ((HID_QUEUE_SIZE & (HID_QUEUE_SIZE - 1)) == 0), "HID_QUEUE_SIZE must be a power of 2, at least 2");
+static_assert(sizeof(THidQueueMouse) <= HID_QUEUE_REPORT_SIZE, "mouse report does not fit into the queue");
+
+typedef struct THidRings {
+  uint8_t report[HID_QUEUE_SIZE][HID_QUEUE_REPORT_SIZE];
+  volatile uint8_t head; // next report to send, moved by the consumer
+  volatile uint8_t tail; // next free place, moved by the producer
+} THidRing;
+
+// Report id, length and key array layout of the queues
+typedef struct THidQueueTypes {
+  uint8_t id;
+  uint8_t length;
+  uint8_t keyOffset; // the key codes follow bit flags (modifiers) before this offset
+  uint8_t keySize;   // bytes of one key code
+} THidQueueType;
+
+static const THidQueueType queueType[HID_QUEUE_COUNT] = {
+  {HID_REPORTID_KEYBOARD, 8, 2, 1},
+  {HID_REPORTID_CONSUMERCONTROL, 8, 0, 2},
+  {HID_REPORTID_SYSTEMCONTROL, 1, 0, 1},
+  {HID_REPORTID_MOUSE, sizeof(THidQueueMouse), 0, 0},
+};
+
+static THidRing ring[HID_QUEUE_COUNT];
+static uint8_t lastFrame;
+static uint8_t nextCore;    // HID core queue served first in the next frame
+static uint32_t progressMs; // last time the queues were empty or the host took a report
+
+static uint16_t keyAt(const uint8_t *report, const THidQueueType *type, uint8_t i) {
+  const uint8_t *key = report + type->keyOffset + i * type->keySize;
+  return (type->keySize == 2) ? (key[0] | (key[1] << 8)) : key[0];
+}
+
+static bool hasKey(const uint8_t *report, const THidQueueType *type, uint16_t key) {
+  for (uint8_t i = 0; i < (type->length - type->keyOffset) / type->keySize; i++) {
+    if (keyAt(report, type, i) == key) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Every key the queued report changed against the one before it keeps its state in the next
+// report, so replacing the queued report by the next one loses no press or release
+static bool mergeable(const THidQueueType *type, const uint8_t *before, const uint8_t *queued, const uint8_t *next) {
+  for (uint8_t i = 0; i < type->keyOffset; i++) {
+    if ((before[i] ^ queued[i]) & (queued[i] ^ next[i])) {
+      return false;
+    }
+  }
+  for (uint8_t i = 0; i < (type->length - type->keyOffset) / type->keySize; i++) {
+    uint16_t key = keyAt(queued, type, i);
+    if ((key) && (!hasKey(before, type, key)) && (!hasKey(next, type, key))) {
+      return false; // pressed and released
+    }
+    key = keyAt(before, type, i);
+    if ((key) && (!hasKey(queued, type, key)) && (hasKey(next, type, key))) {
+      return false; // released and pressed again
+    }
+  }
+  return true;
+}
+
+bool hidQueuePush(enum THidQueue queue, const void *report) {
+  THidRing *r = &ring[queue];
+  const THidQueueType *type = &queueType[queue];
+  uint8_t count = (uint8_t)(r->tail - r->head);
+  if (count >= 2) {
+    // the last report is not at the head, the consumer does not touch it
+    uint8_t *queued = r->report[(r->tail - 1) & (HID_QUEUE_SIZE - 1)];
+    const uint8_t *before = r->report[(r->tail - 2) & (HID_QUEUE_SIZE - 1)];
+    if (queue == HID_QUEUE_MOUSE) {
+      THidQueueMouse *m = (THidQueueMouse *)queued;
+      const THidQueueMouse *n = (const THidQueueMouse *)report;
+      // a button change or a sum beyond the report range needs a report of its own
+      if ((m->buttons == n->buttons) && (abs(m->x + n->x) <= 127) && (abs(m->y + n->y) <= 127) &&
+          (labs((long)m->wheel + n->wheel) <= 32767) && (labs((long)m->pan + n->pan) <= 32767)) {
+        m->x += n->x;
+        m->y += n->y;
+        m->wheel += n->wheel;
+        m->pan += n->pan;
+        statsCount(STATS_REPORTS_MERGED);
+        return true;
+      }
+      if (count == HID_QUEUE_SIZE) {
+        return false;
+      }
+    }
+    else {
+      bool merge = mergeable(type, before, queued, (const uint8_t *)report);
+      if ((merge) || (count == HID_QUEUE_SIZE)) {
+        statsCount(merge ? STATS_REPORTS_MERGED : STATS_REPORTS_DROPPED);
+        memcpy(queued, report, type->length);
+        return true;
+      }
+    }
+  }
+  memcpy(r->report[r->tail & (HID_QUEUE_SIZE - 1)], report, type->length);
+  r->tail++;
+  return true;
+}
+
+// Sends the report at the head if the endpoint bank is free
+static bool send(enum THidQueue queue) {
+  THidRing *r = &ring[queue];
+  const THidQueueType *type = &queueType[queue];
+  if (r->head == r->tail) {
+    return false;
+  }
+  uint8_t *report = r->report[r->head & (HID_QUEUE_SIZE - 1)];
+  uint32_t start = statsCycles();
+  if (queue == HID_QUEUE_MOUSE) {
+    if (!HMouse.ready()) {
+      return false;
+    }
+    THidQueueMouse *m = (THidQueueMouse *)report;
+    HMouse.send(m->buttons, m->x, m->y, m->wheel, m->pan);
+  } else {
+    if (!HCore_::ready(type->length)) {
+      return false;
+    }
+    HID().SendReport(type->id, report, type->length);
+    statsReportSent();
+  }
+  statsSince(STATS_SEND, start);
+  r->head++;
+  return true;
+}
+
+void hidQueueRun() {
+  uint32_t now = millis();
+  uint8_t frame = usbFrame();
+  if (frame != lastFrame) {
+    lastFrame = frame;
+    if (send(HID_QUEUE_MOUSE)) {
+      progressMs = now;
+    }
+    // keyboard, consumer and system share the HID core endpoint, one report per frame
+    for (uint8_t i = 0; i < HID_QUEUE_MOUSE; i++) {
+      uint8_t queue = (nextCore + i) % HID_QUEUE_MOUSE;
+      if (send((enum THidQueue)queue)) {
+        nextCore = (queue + 1) % HID_QUEUE_MOUSE;
+        progressMs = now;
+        break;
+      }
+    }
+  }
+
+  if (!hidQueueBusy()) {
+    progressMs = now;
+  }
+  else if ((now - progressMs) > HID_QUEUE_TIMEOUT_MS) {
+    for (uint8_t i = 0; i < HID_QUEUE_COUNT; i++) {
+      statsCount(STATS_REPORTS_DROPPED, (uint8_t)(ring[i].tail - ring[i].head));
+      ring[i].head = ring[i].tail;
+    }
+  }
+}
+
+bool hidQueueBusy() {
+  for (uint8_t i = 0; i < HID_QUEUE_COUNT; i++) {
+    if (ring[i].head != ring[i].tail) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool hidQueueEmpty(enum THidQueue queue) {
+  return ring[queue].head == ring[queue].tail;
+}
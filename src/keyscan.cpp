@@ -0,0 +1,44 @@
+#include "keyscan.h"
+#include "expander.h"
+
+#if KEY_MATRIX
+typedef TKeyMatrix<keyRowPin, KEY_MATRIX_ROWS, keyColPin, KEY_MATRIX_COLS, KEY_MATRIX_DIODES, KEY_MATRIX_SETTLE_US> TKeypadMatrix;
+
+static void localScanBegin() {
+  TKeypadMatrix::begin();
+}
+
+static inline TKeyMask localScan() {
+  return TKeypadMatrix::scan();
+}
+#else
+static void localScanBegin() {
+  for (uint8_t i = 0; i < NUMBER_OF_LOCAL_KEYS; i++) {
+    pinMode(keyPin[i], INPUT_PULLUP);
+  }
+}
+
+static inline TKeyMask localScan() {
+  uint8_t snapshot[PORT_COUNT];
+  readPorts<keyPin, NUMBER_OF_LOCAL_KEYS>(snapshot);
+  return TPinGather<TKeyMask, keyPin, NUMBER_OF_LOCAL_KEYS>::gatherLow(snapshot);
+}
+#endif
+
+void keyScanBegin() {
+  localScanBegin();
+#if KEY_EXPANDER != EXPANDER_NONE
+  expanderBegin(KEY_EXPANDER, EXPANDER_CHIPS);
+  expanderStart();
+#endif
+}
+
+TKeyMask keyScan() {
+  TKeyMask pressed = localScan();
+#if KEY_EXPANDER != EXPANDER_NONE
+  // the keys of the last finished read, the next one runs while the loop handles these
+  pressed |= (TKeyMask)expanderKeys() << NUMBER_OF_LOCAL_KEYS;
+  expanderStart();
+#endif
+  return pressed;
+}
@@ -0,0 +1,65 @@
+#include "keytimer.h"
+
+static_assert((KEY_TIMER_SLOTS & (KEY_TIMER_SLOTS - 1)) == 0, "KEY_TIMER_SLOTS must be a power of 2");
+
+static TKeyMask wheel[KEY_TIMER_SLOTS]; // keys with a deadline in the slot's millisecond of some turn
+static TKeyMask running;                // keys with a timer
+static TKeyMask late;                   // keys set to a deadline in a slot already passed
+static uint32_t deadline[NUMBER_OF_KEYS_AND_COMBOS];
+static uint32_t lastMs; // millisecond whose slot was looked at last
+
+void keyTimerBegin() {
+  for (uint8_t i = 0; i < KEY_TIMER_SLOTS; i++) {
+    wheel[i] = 0;
+  }
+  running = 0;
+  late = 0;
+  lastMs = millis();
+}
+
+void keyTimerSet(uint8_t keyIndex, uint32_t deadlineMs) {
+  keyTimerCancel(keyIndex);
+  TKeyMask bit = (TKeyMask)1 << keyIndex;
+  deadline[keyIndex] = deadlineMs;
+  running |= bit;
+  if ((int32_t)(deadlineMs - lastMs) <= 0) {
+    late |= bit;
+  } else {
+    wheel[deadlineMs & (KEY_TIMER_SLOTS - 1)] |= bit;
+  }
+}
+
+void keyTimerCancel(uint8_t keyIndex) {
+  TKeyMask bit = (TKeyMask)1 << keyIndex;
+  if (running & bit) {
+    wheel[deadline[keyIndex] & (KEY_TIMER_SLOTS - 1)] &= ~bit;
+    late &= ~bit;
+    running &= ~bit;
+  }
+}
+
+TKeyMask keyTimerExpired(uint32_t now) {
+  TKeyMask expired = late;
+  late = 0;
+  uint32_t passed = now - lastMs;
+  lastMs = now;
+  if (!running) {
+    return 0;
+  }
+  // after a turn or more every slot is due once
+  if (passed > KEY_TIMER_SLOTS) {
+    passed = KEY_TIMER_SLOTS;
+  }
+  for (uint32_t ms = now - passed + 1; passed; passed--, ms++) {
+    TKeyMask *slot = &wheel[ms & (KEY_TIMER_SLOTS - 1)];
+    for (TKeyMask keys = *slot; keys; ) {
+      uint8_t i = keyMaskPop(&keys);
+      if ((int32_t)(now - deadline[i]) >= 0) {
+        expired |= (TKeyMask)1 << i;
+      }
+    }
+    *slot &= ~expired;
+  }
+  running &= ~expired;
+  return expired;
+}
@@ -0,0 +1,82 @@
+#include "layer.h"
+#include "macro.h"
+
+static uint8_t momentary; // bit per layer held by a key
+static uint8_t holders[NUMBER_OF_LAYERS]; // keys down holding layer i, a layer ends with its last key
+static uint8_t toggled;   // bit per layer switched on
+static uint8_t oneShot;   // bit per layer waiting for the next key
+static uint8_t top;
+
+static void update() {
+  uint8_t mask = 1 | momentary | toggled | oneShot;
+  top = 0;
+  for (uint8_t layer = 1; layer < NUMBER_OF_LAYERS; layer++) {
+    if (mask & (1 << layer)) {
+      top = layer;
+    }
+  }
+  macroLayers(mask);
+}
+
+// A key holding the layer went down or up
+static void hold(uint8_t layer, bool press) {
+  if (press) {
+    holders[layer]++;
+  } else if (holders[layer]) {
+    holders[layer]--;
+  }
+  if (holders[layer]) {
+    momentary |= (1 << layer);
+  } else {
+    momentary &= ~(1 << layer);
+  }
+}
+
+void layerBegin() {
+  momentary = toggled = oneShot = 0;
+  memset(holders, 0, sizeof(holders));
+  update();
+}
+
+bool layerBinding(uint16_t binding) {
+  uint8_t op = macroByte(binding);
+  return (op == OP_LAYER_MOMENTARY) || (op == OP_LAYER_TOGGLE) || (op == OP_LAYER_ONESHOT);
+}
+
+void layerKey(uint16_t binding, bool press) {
+  uint8_t op = macroByte(binding);
+  uint8_t layer = macroByte(binding + 1);
+  if ((!layerBinding(binding)) || (layer == 0) || (layer >= NUMBER_OF_LAYERS)) {
+    return;
+  }
+  if (op == OP_LAYER_MOMENTARY) {
+    hold(layer, press);
+  }
+  else if (press) {
+    if (op == OP_LAYER_TOGGLE) {
+      toggled ^= (1 << layer);
+    } else {
+      oneShot |= (1 << layer);
+    }
+  }
+  update();
+}
+
+void layerHold(uint8_t layer, bool press) {
+  if ((layer == 0) || (layer >= NUMBER_OF_LAYERS)) {
+    return;
+  }
+  hold(layer, press);
+  update();
+}
+
+void layerKeyDone() {
+  if (oneShot) {
+    oneShot = 0;
+    update();
+  }
+}
+
+uint8_t layerTop() {
+  return top;
+}
@@ -0,0 +1,66 @@
+#include "macro.h"
+
+static_assert(NUMBER_OF_LAYERS <= 8, "layers are a bit mask of 8 bits");
+static_assert(keymapBaseSize(NUMBER_OF_LAYERS, NUMBER_OF_BINDINGS) <= KEYMAP_MAX_SIZE, "a keymap for all keys and layers does not fit into KEYMAP_MAX_SIZE");
+// the most keys and combos of the 64 bit key mask and 4 encoders on 2 layers
+static_assert(keymapBaseSize(2, 64 + 4 * ENCODER_EVENTS) <= KEYMAP_MAX_SIZE, "a keymap for the largest keypad does not fit into KEYMAP_MAX_SIZE");
+
+static uint16_t layerBinding[NUMBER_OF_LAYERS][NUMBER_OF_BINDINGS]; // binding of every key in every layer
+static uint16_t binding[NUMBER_OF_BINDINGS];                        // binding of every key in the active layers
+static uint8_t activeLayers = 1;
+
+uint8_t macroCache[KEYMAP_MAX_SIZE];
+uint16_t macroCacheSize;
+
+void macroBegin() {
+  macroCacheSize = keymapSize;
+  memcpy_P(macroCache, keymap, macroCacheSize);
+  macroBind();
+}
+
+void macroBind() {
+  uint16_t pos = 0;
+  for (uint8_t layer = 0; layer < NUMBER_OF_LAYERS; layer++) {
+    for (uint8_t i = 0; i < NUMBER_OF_BINDINGS; i++) {
+      layerBinding[layer][i] = pos;
+      while (macroByte(pos) != OP_END) {
+        pos = macroNext(pos);
+      }
+      if (pos < macroCacheSize) {
+        pos++;
+      }
+    }
+  }
+  macroLayers(activeLayers);
+}
+
+// Runs only when layers or the keymap change, keys then find their binding with one table read
+void macroLayers(uint8_t layerMask) {
+  activeLayers = layerMask;
+  for (uint8_t i = 0; i < NUMBER_OF_BINDINGS; i++) {
+    binding[i] = layerBinding[0][i];
+    for (uint8_t layer = NUMBER_OF_LAYERS - 1; layer > 0; layer--) {
+      if ((layerMask & (1 << layer)) && (macroByte(layerBinding[layer][i]) != OP_END)) {
+        binding[i] = layerBinding[layer][i];
+        break;
+      }
+    }
+  }
+}
+
+uint16_t macroBinding(uint8_t keyIndex) {
+  return binding[keyIndex];
+}
+
+uint8_t macroByte(uint16_t pos) {
+  return (pos < macroCacheSize) ? macroCache[pos] : OP_END;
+}
+
+uint16_t macroWord(uint16_t pos) {
+  return macroByte(pos) | (macroByte(pos + 1) << 8);
+}
+
+uint16_t macroNext(uint16_t pos) {
+  uint8_t len = macroOpLength(macroByte(pos));
+  return pos + (len ? len : 1);
+}
@@ -1,227 +1,235 @@
 #include <Arduino.h>
 #include <HID-Project.h>
 #include <HMouse.h>
-#include <ClickEncoder.h>
-#include <TimerOne.h>
-
-#define NUMBER_OF_KEYS 8       // Count of keys in the keyboard
-#define MAX_COMBINATION_KEYS 4 // Maximum number of key codes that can be pressed at the same time (does dont correspond to actually pressed keys)
-#define MAX_SEQUENCE_KEYS 16   // Maximum length of key combination sequence (that means first you send CTRL + Z (1. combination), then SHIFT + ALT + X (2. combination), then A (3. combination) ... )
-
-#define DEBOUNCING_MS 20         // wait in ms when key can oscilate
-#define FIRST_REPEAT_CODE_MS 500 // after FIRST_REPEAT_CODE_MS ,s if key is still pressed, start sending the command again
-#define REPEAT_CODE_MS 150       // when sending command by holding down key, wait this long before sending command egain
-
-// Rotary encoder connections
-#define ENCODER_CLK 4
-#define ENCODER_DT 3
-#define ENCODER_SW 2
-
-// Defining types
-enum TKeyState {
-  INACTIVE,
-  DEBOUNCING,
-  ACTIVE,
-  HOLDING
-}; // Key states - INACTIVE -> DEBOUNCING -> ACTIVE -> HOLDING -> INACTIVE
-//                                                                                                               -> INACTIVE
-enum TKeyType {
-  KEYBOARD,
-  CONSUMER,
-  SYSTEM,
-  MODIFIER
-}; // Types of key codes - simulating keyboard, mouse, multimedia or modifier that alters the rotary encoder behavior
-
-typedef struct TActions {
-  uint16_t durationMs;
-  uint16_t key[MAX_COMBINATION_KEYS];
-} TAction;
-
-typedef struct TKeys {
-  uint8_t pin;
-  enum TKeyType type;
-  enum TKeyState state;
-  uint32_t stateStartMs;
-  uint16_t modificatorKeys[MAX_COMBINATION_KEYS];
-  TAction action[MAX_SEQUENCE_KEYS];
-} TKey;
-
-// Define actions for your keys
-TKey key[NUMBER_OF_KEYS] = {
-  {.pin = 9, .type = KEYBOARD, .state = INACTIVE, .stateStartMs = 0, .modificatorKeys = {}, .action = {{.durationMs = 0, .key = {KEY_F13}}}},
-  {.pin = 8, .type = KEYBOARD, .state = INACTIVE, .stateStartMs = 0, .modificatorKeys = {}, .action = {{.durationMs = 0, .key = {KEY_F14}}}},
-  {.pin = 7, .type = KEYBOARD, .state = INACTIVE, .stateStartMs = 0, .modificatorKeys = {}, .action = {{.durationMs = 0, .key = {KEY_F15}}}},
-  {.pin = 6, .type = KEYBOARD, .state = INACTIVE, .stateStartMs = 0, .modificatorKeys = {}, .action = {{.durationMs = 0, .key = {KEY_F16}}}},
-  {.pin = 10, .type = KEYBOARD, .state = INACTIVE, .stateStartMs = 0, .modificatorKeys = {}, .action = {{.durationMs = 0, .key = {KEY_F17}}}},
-  {.pin = 16, .type = KEYBOARD, .state = INACTIVE, .stateStartMs = 0, .modificatorKeys = {}, .action = {{.durationMs = 0, .key = {KEY_F18}}}},
-  {.pin = 14, .type = KEYBOARD, .state = INACTIVE, .stateStartMs = 0, .modificatorKeys = {}, .action = {{.durationMs = 50, .key = {KEY_F19}}}},
-  {.pin = 15, .type = KEYBOARD, .state = INACTIVE, .stateStartMs = 0, .modificatorKeys = {}, .action = {{.durationMs = 50, .key = {KEY_F20}}}},
+#include "keypad.h"
+#include "combo.h"
+#include "config.h"
+#include "debounce.h"
+#include "encoder.h"
+#include "hidqueue.h"
+#include "keyscan.h"
+#include "keytimer.h"
+#include "layer.h"
+#include "macro.h"
+#include "mousekeys.h"
+#include "power.h"
+#include "report.h"
+#include "rotary.h"
+#include "sequencer.h"
+#include "stats.h"
+#include "stream.h"
+#include "taphold.h"
+
+// Define actions for your keys (see macro.h). Every layer has one binding per key in the order of
+// keyPin[], then one per combo in the order of comboKeys[], then five per encoder in the order of
+// encoderPin[]: a detent clockwise and counterclockwise (when encoderAction[] is
+// ENCODER_BINDINGS), the button click, double click and hold. An empty binding (MACRO_END) uses the
+// binding of the next lower active layer. This is the factory keymap, tools/keypadcfg can replace
+// it at runtime without reflashing:
+//   MACRO_KEY(KEY_F13), MACRO_TAP, MACRO_END                                - tap F13
+//   MACRO_MOD(KEY_LEFT_CTRL), MACRO_KEY(KEY_Z), MACRO_TAP, MACRO_END        - CTRL + Z
+//   MACRO_KEY(KEY_A), MACRO_PRESS(50), MACRO_KEY(KEY_B), MACRO_TAP, MACRO_END - A held 50 ms, then B
+//   MACRO_CONSUMER(MEDIA_VOLUME_MUTE), MACRO_TAP, MACRO_END                 - multimedia key
+//   MACRO_SYSTEM(SYSTEM_SLEEP), MACRO_END                                   - system key
+//   MACRO_MOUSE_BUTTON(MOUSE_LEFT), MACRO_TAP, MACRO_END                    - mouse click
+//   MACRO_KEY(KEY_A), MACRO_TAP, MACRO_WAIT(100), MACRO_KEY(KEY_B), MACRO_TAP, MACRO_END - A, pause, B
+//   MACRO_KEY(KEY_LEFT_CTRL), MACRO_KEY(KEY_C), MACRO_TAP, MACRO_MOUSE_SCROLL(5, 0), MACRO_TAP,
+//     MACRO_MOUSE_BUTTON(MOUSE_LEFT), MACRO_TAP, MACRO_END                - CTRL + C, scroll 5 notches, click
+//   MACRO_LAYER_MOMENTARY(1), MACRO_END                                     - layer 1 while held
+//   MACRO_LAYER_TOGGLE(1), MACRO_END                                        - layer 1 on / off
+//   MACRO_LAYER_ONESHOT(1), MACRO_END                                       - layer 1 for the next key
+//   MACRO_HOLD_MOD(KEY_LEFT_CTRL), MACRO_KEY(KEY_ESC), MACRO_TAP, MACRO_END  - ESC on tap, CTRL while held
+//   MACRO_HOLD_LAYER(1), MACRO_KEY(KEY_F13), MACRO_TAP, MACRO_END           - F13 on tap, layer 1 while held
+//   MACRO_MOUSE_KEYS(MOUSE_KEY_UP | MOUSE_KEY_LEFT), MACRO_END              - pointer up-left while held
+//   MACRO_MOUSE_KEYS(MOUSE_KEY_WHEEL_DOWN), MACRO_END                       - scroll down while held
+//   MACRO_NONE, MACRO_END                                                   - nothing, not even lower layers
+// The encoder events are taps, momentary layers and mouse keys have no effect there. KEYMAP_ASSERT() stops
+// the build on a wrong binding count, key code or layer number (see keymapCheck() in macro.h).
+constexpr uint8_t keymap[] PROGMEM = {
+  // layer 0
+  MACRO_KEY(KEY_F13), MACRO_TAP, MACRO_END,
+  MACRO_KEY(KEY_F14), MACRO_TAP, MACRO_END,
+  MACRO_KEY(KEY_F15), MACRO_TAP, MACRO_END,
+  MACRO_KEY(KEY_F16), MACRO_TAP, MACRO_END,
+  MACRO_KEY(KEY_F17), MACRO_TAP, MACRO_END,
+  MACRO_KEY(KEY_F18), MACRO_TAP, MACRO_END,
+  MACRO_KEY(KEY_F19), MACRO_PRESS(50), MACRO_END,
+  MACRO_KEY(KEY_F20), MACRO_PRESS(50), MACRO_END,
+  MACRO_KEY(KEY_F22), MACRO_TAP, MACRO_END, // combo of the last two keys
+  MACRO_END, MACRO_END, // encoder detents, it pans
+  MACRO_LAYER_TOGGLE(1), MACRO_END, // encoder click
+  MACRO_KEY(KEY_F21), MACRO_TAP, MACRO_END, // encoder double click
+  MACRO_END, // encoder hold
+  // layer 1 - the encoder scrolls vertically
+  MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END,
+  MACRO_END,
+  MACRO_END, MACRO_END, MACRO_END, MACRO_END, MACRO_END,
 };
+const uint16_t keymapSize = sizeof(keymap);
+KEYMAP_ASSERT(keymap);
 
-// global variables
-ClickEncoder *encoder;
-int16_t last, value;
-bool globalModifier;
+// Action of the rotation of every encoder and its acceleration curve in every layer
+enum TEncoderAction encoderAction[NUMBER_OF_ENCODERS][NUMBER_OF_LAYERS] = {
+  {ENCODER_PAN, ENCODER_WHEEL},
+};
+enum TEncoderCurve encoderLayerCurve[NUMBER_OF_ENCODERS][NUMBER_OF_LAYERS] = {
+  {ENCODER_CURVE_SCROLL, ENCODER_CURVE_SCROLL},
+};
 
-// Capture rotary encoder pulses
-void timerIsr() {
-  encoder->service();
-}
+// Gains of the acceleration curves (see encoder.h), ENCODER_CURVE_ONE (16) is 1:1. Point i applies
+// from i * ENCODER_CURVE_RATE_STEP (4) detents per second up.
+const uint8_t encoderCurve[ENCODER_CURVES][ENCODER_CURVE_POINTS] PROGMEM = {
+  // ENCODER_CURVE_LINEAR
+  {16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16},
+  // ENCODER_CURVE_SCROLL - 1:1 below 8 detents/s, 2x at 16, 4x at 28, 12x from 60 up
+  {16, 16, 20, 24, 32, 40, 48, 64, 80, 96, 112, 128, 144, 160, 176, 192},
+  // ENCODER_CURVE_VOLUME - 1:1 below 12 detents/s, at most 3x
+  {16, 16, 16, 20, 24, 28, 32, 36, 40, 44, 48, 48, 48, 48, 48, 48},
+};
 
-// Execute key commands
-uint8_t processKey(uint8_t keyIndex) {
-  TKey *lkey = &key[keyIndex];
-  if (lkey->type == KEYBOARD) {
-    // Press modificators
-    for (uint8_t i = 0; i < MAX_COMBINATION_KEYS; i++) {
-      if (lkey->modificatorKeys[i]) {
-        Keyboard.press((KeyboardKeycode)lkey->modificatorKeys[i]);
-      } else {
-        break;
-      }
+// Repeat profiles (see TKeyRepeat in keypad.h): delay, interval, fastest interval, speed up per repeat
+const TKeyRepeat keyRepeatProfile[KEY_REPEAT_PROFILES] PROGMEM = {
+  {FIRST_REPEAT_CODE_MS, REPEAT_CODE_MS, REPEAT_CODE_MS, 0}, // KEY_REPEAT_DEFAULT
+  {0, 0, 0, 0},                                              // KEY_REPEAT_NONE
+  {300, 120, 30, 15},                                        // KEY_REPEAT_ACCELERATE - 120 ms down to 30 ms in 6 repeats
+};
+
+// Repeat profile of every key and combo, in the order of the bindings, KEY_REPEAT_DEFAULT when not listed
+enum TKeyRepeatProfile keyRepeat[NUMBER_OF_KEYS_AND_COMBOS] = {};
+
+TKey key[NUMBER_OF_KEYS_AND_COMBOS];
+static TKeyMask keysDown;    // keys and combos that are not INACTIVE
+static TKeyMask keysWaiting; // pressed, waiting for a free sequencer slot
+static TKeyMask keysPressed; // the pressed keys of the last pass
+
+// Execute key commands, repeat: the key is held down and sends its sequence again. Returns false
+// when all sequencer slots are in use.
+bool processKey(uint8_t keyIndex, uint16_t binding, bool repeat, uint32_t now) {
+  if (layerBinding(binding)) {
+    if (!repeat) {
+      layerKey(binding, true);
     }
-    for (uint8_t i = 0; i < MAX_SEQUENCE_KEYS; i++) {
-      TAction *laction = &lkey->action[i];
-      if ((laction->durationMs) || (laction->key[0])) {
-        //press keys
-        for (uint8_t j = 0; j < MAX_COMBINATION_KEYS; j++) {
-          if (laction->key[j]) {
-            Keyboard.press((KeyboardKeycode)laction->key[j]);
-          } else {
-            break;
-          }
-        }
-        // wait
-        if (laction->durationMs) {
-          delay(laction->durationMs);
-        }
-        //release keys
-        for (uint8_t j = 0; j < MAX_COMBINATION_KEYS; j++) {
-          if (laction->key[j]) {
-            Keyboard.release((KeyboardKeycode)laction->key[j]);
-          } else {
-            break;
-          }
-        }
-      }
-      else {
-        break;
-      }
+  } else if (mouseKeysBinding(binding)) {
+    if (!repeat) {
+      mouseKeysKey(binding, true);
+      layerKeyDone();
     }
-    Keyboard.releaseAll();
-  }
-  else if (lkey->type == CONSUMER) {
-    for (uint8_t i = 0; i < MAX_SEQUENCE_KEYS; i++) {
-      TAction *laction = &lkey->action[i];
-      if ((laction->durationMs) || (laction->key[0])) {
-        //press keys
-        for (uint8_t j = 0; j < MAX_COMBINATION_KEYS; j++) {
-          if (laction->key[j]) {
-            Consumer.press((ConsumerKeycode)laction->key[j]);
-          } else {
-            break;
-          }
-        }
-        // wait
-        if (laction->durationMs) {
-          delay(laction->durationMs);
-        }
-        //release keys
-        for (uint8_t j = 0; j < MAX_COMBINATION_KEYS; j++) {
-          if (laction->key[j]) {
-            Consumer.release((ConsumerKeycode)laction->key[j]);
-          } else {
-            break;
-          }
-        }
-      } else {
-        break;
-      }
+  } else {
+    if (!sequencerStart(keyIndex, binding, now)) {
+      return false;
     }
-    Consumer.releaseAll();
+    layerKeyDone();
   }
-  else if (lkey->type == SYSTEM) {
-    if (lkey->action[0].key[0]) {
-      System.write((SystemKeycode)lkey->action[0].key[0]);
-    }
+  return true;
+}
+
+// Key release
+void releaseKey(uint8_t keyIndex) {
+  if (layerBinding(key[keyIndex].binding)) {
+    layerKey(key[keyIndex].binding, false);
   }
+  mouseKeysKey(key[keyIndex].binding, false);
 }
 
-void checkKeys() {
+// Press and release of an event without a key, like the encoder button click. Returns false when
+// all sequencer slots are in use or the event still plays.
+bool tapKey(uint8_t keyIndex, uint32_t now) {
+  uint16_t binding = macroBinding(keyIndex);
+  if (!processKey(keyIndex, binding, false, now)) {
+    return false;
+  }
+  if (layerBinding(binding)) {
+    layerKey(binding, false);
+  }
+  mouseKeysKey(binding, false);
+  return true;
+}
+
+// Starts the wait for the next repeat of a held key, keys that only switch layers or hold mouse
+// keys and keys without repeat get no timer
+static void repeatSchedule(uint8_t keyIndex, uint32_t now, bool first) {
+  TKey *k = &key[keyIndex];
+  TKeyRepeat repeat;
+  memcpy_P(&repeat, &keyRepeatProfile[keyRepeat[keyIndex]], sizeof(repeat));
+  if ((!repeat.delayMs) || (layerBinding(k->binding)) || (mouseKeysBinding(k->binding))) {
+    return;
+  }
+  // the repeat comes once more than the wait has passed, as it always did
+  if (first) {
+    k->repeatMs = repeat.intervalMs;
+    keyTimerSet(keyIndex, now + repeat.delayMs + 1);
+  } else {
+    keyTimerSet(keyIndex, now + k->repeatMs + 1);
+    k->repeatMs = (k->repeatMs > repeat.fastestMs + repeat.stepMs) ? k->repeatMs - repeat.stepMs : repeat.fastestMs;
+  }
+}
+
+// Returns true while some key is not INACTIVE or waits for debounce. Only the keys whose state
+// changed, that wait for a sequencer slot or whose repeat is due are visited (see keytimer.h).
+bool checkKeys(uint32_t now) {
   // read the key's states and if one is pressed, execute the associated command
-  for (uint8_t i = 0; i < NUMBER_OF_KEYS; i++) {
-    uint8_t keyState = digitalRead(key[i].pin);
-    if ((key[i].state == INACTIVE) && (keyState == LOW)) {
-      key[i].state = DEBOUNCING;
-      key[i].stateStartMs = millis();
-    }
-    else if (key[i].state == DEBOUNCING) {
-      if (keyState == HIGH) {
-        key[i].stateStartMs = millis();
+  TKeyMask pressed = tapHold(combo(debounce(keyScan(), now), now), now);
+  TKeyMask due = keyTimerExpired(now);
+  TKeyMask visit = (pressed ^ keysPressed) | keysWaiting | due;
+  keysPressed = pressed;
+  while (visit) {
+    uint8_t i = keyMaskPop(&visit);
+    TKeyMask bit = (TKeyMask)1 << i;
+    bool keyDown = pressed & bit;
+    if (key[i].state == INACTIVE) {
+      keysWaiting &= ~bit;
+      if (!keyDown) {
+        continue;
       }
-      else if ((millis() - key[i].stateStartMs) > DEBOUNCING_MS) {
+      // a press finding no free sequencer slot is tried again in the next pass. The binding is
+      // taken before processKey() switches layers, the release goes to the same binding.
+      uint16_t binding = macroBinding(i);
+      if (processKey(i, binding, false, now)) {
+        statsKeyEvent();
         key[i].state = ACTIVE;
-        processKey(i);
+        key[i].binding = binding;
+        keysDown |= bit;
+        repeatSchedule(i, now, true);
+      } else {
+        keysWaiting |= bit;
       }
     }
-    else if (key[i].state == ACTIVE) {
-      if (keyState == HIGH) {
-        key[i].state = INACTIVE;
-        key[i].stateStartMs = millis();
-        if (key[i].type == MODIFIER) {
-          globalModifier = false;
-        }
-      }
-      else if ((millis() - key[i].stateStartMs) > FIRST_REPEAT_CODE_MS) {
-        key[i].state = HOLDING;
-        key[i].stateStartMs = millis();
-        processKey(i);
-      }
+    else if (!keyDown) {
+      statsKeyEvent();
+      key[i].state = INACTIVE;
+      keysDown &= ~bit;
+      keyTimerCancel(i);
+      releaseKey(i);
     }
-    else if (key[i].state == HOLDING) {
-      if (keyState == HIGH) {
-        key[i].state = INACTIVE;
-        key[i].stateStartMs = millis();
-        if (key[i].type == MODIFIER) {
-          globalModifier = false;
-        }
-      }
-      else if ((millis() - key[i].stateStartMs) > REPEAT_CODE_MS) {
-        key[i].stateStartMs = millis();
-        processKey(i);
-      }
+    else if (due & bit) {
+      key[i].state = HOLDING;
+      processKey(i, key[i].binding, true, now);
+      repeatSchedule(i, now, false);
     }
   }
+  return (keysDown) || (keysWaiting) || debounceBusy() || comboBusy() || tapHoldBusy();
 }
 
-void processEncoder() {
-  value += encoder->getValue();
-  if (value != last) {
-    uint16_t diff = abs(value - last);
-    signed char wheel = (last < value) ? 1 : -1;
-    for (uint8_t i = 0; i < diff; i++) {
-      if (globalModifier) {
-        HMouse.move(0, 0, wheel, 0);
-      } else {
-        HMouse.move(0, 0, 0, wheel);
-      }
+void processEncoder(uint32_t now) {
+  static const uint8_t buttonEvent[] = {0, ENCODER_CLICK, ENCODER_DOUBLE_CLICK, ENCODER_HOLD}; // by TRotaryEventType
+  TRotaryEvent event;
+  rotaryPoll();
+  while (rotaryRead(&event, now)) {
+    if (event.type == ROTARY_STEP) {
+      encoderAdd(event.encoder, encoderAction[event.encoder][layerTop()], encoderLayerCurve[event.encoder][layerTop()],
+                 event.steps, event.timeMs);
+    } else {
+      tapKey(ENCODER_KEY(event.encoder, buttonEvent[event.type]), now);
     }
-    last = value;
   }
-}
-
-void processEncoderBtn() {
-  ClickEncoder::Button b = encoder->getButton(); // Asking the button for it's current state
-  if (b != ClickEncoder::Open) { // If the button is unpressed, we'll skip to the end of this if block
-    switch (b) {
-      case ClickEncoder::Clicked: // Button was clicked once
-        globalModifier = !globalModifier;
-        break;
-      case ClickEncoder::DoubleClicked: // Button was double clicked
-        Keyboard.write(KEY_F21);
-        break;
+  // a detent waits while its previous one still plays
+  for (uint8_t e = 0; e < NUMBER_OF_ENCODERS; e++) {
+    int8_t detent = encoderDetent(e);
+    if ((detent) && (tapKey(ENCODER_KEY(e, (detent > 0) ? ENCODER_CW : ENCODER_CCW), now))) {
+      encoderDetentDone(e);
     }
   }
+  encoderFlush();
 }
 
 void setup() {
@@ -230,20 +238,38 @@ void setup() {
   System.begin();
   HMouse.begin();
 
-  encoder = new ClickEncoder(ENCODER_DT, ENCODER_CLK, ENCODER_SW, 4);
-  for (uint8_t i = 0; i < NUMBER_OF_KEYS; i++) {
-    pinMode(key[i].pin, INPUT_PULLUP);
-  }
+  rotaryBegin();
+  keyScanBegin();
+  debounceBegin();
+  comboBegin();
+  tapHoldBegin();
+  keyTimerBegin();
 
-  Timer1.initialize(250);
-  Timer1.attachInterrupt(timerIsr);
+  macroBegin();
+  configBegin();
+  layerBegin();
+  sequencerBegin();
+  mouseKeysBegin();
+  powerBegin();
 
-  last = -1;
-  globalModifier = false;
+  statsBegin();
 }
 
 void loop() {
-  checkKeys();
-  processEncoder();
-  processEncoderBtn();
+  static uint32_t loopStart;
+  uint32_t scanStart = statsCycles();
+  statsRecord(STATS_LOOP, scanStart - loopStart);
+  loopStart = scanStart;
+
+  uint32_t now = millis();
+  bool keysBusy = checkKeys(now);
+  statsSince(STATS_SCAN, scanStart);
+  sequencerRun(now);
+  configRun(keysBusy || sequencerBusy());
+  processEncoder(now);
+  streamRun();
+  mouseKeysRun();
+  reportSend();
+  hidQueueRun();
+  powerSleep(keysBusy || sequencerBusy() || encoderBusy() || mouseKeysBusy() || rotaryBusy() || configBusy() || streamBusy() || hidQueueBusy());
 }
@@ -0,0 +1,99 @@
+#include "mousekeys.h"
+#include "macro.h"
+#include "report.h"
+#include "usbframe.h"
+
+// Motion of the pointer or of the scroll
+typedef struct TMouseKeysMotions {
+  uint16_t speed;        // 1/256 units per frame, 0 while no direction of the motion is held
+  int16_t remainderX;    // fraction of a unit not sent yet in 1/256
+  int16_t remainderY;
+} TMouseKeysMotion;
+
+static uint8_t held;       // MOUSE_KEY_* directions of the keys down
+static uint8_t holders[8]; // keys down holding direction bit i, a direction ends with its last key
+static uint8_t lastFrame;
+static TMouseKeysMotion move, scroll;
+
+// Distance of one axis in one frame, the whole units go out, the fraction stays
+static int8_t axisStep(int16_t *remainder, int8_t direction, uint16_t speed) {
+  *remainder += direction * (int16_t)speed;
+  int8_t whole = *remainder / 256;
+  *remainder -= whole * 256;
+  return whole;
+}
+
+// One frame of a motion, directions -1, 0 or 1 per axis. Returns false when no direction is held.
+static bool motionStep(TMouseKeysMotion *m, bool active, int8_t x, int8_t y, uint16_t start, uint16_t max, uint8_t accel,
+                       int8_t *stepX, int8_t *stepY) {
+  if (!active) {
+    *m = {0, 0, 0};
+    return false;
+  }
+  m->speed = (m->speed == 0) ? start : (m->speed + accel < max) ? m->speed + accel : max;
+  uint16_t speed = ((x) && (y)) ? (uint16_t)(((uint32_t)m->speed * MOUSEKEYS_DIAGONAL) >> 8) : m->speed;
+  *stepX = axisStep(&m->remainderX, x, speed);
+  *stepY = axisStep(&m->remainderY, y, speed);
+  return true;
+}
+
+// -1, 0 or 1 from the bits of the negative and the positive direction
+static inline int8_t axis(uint8_t negative, uint8_t positive) {
+  return ((held & positive) ? 1 : 0) - ((held & negative) ? 1 : 0);
+}
+
+void mouseKeysBegin() {
+  held = 0;
+  memset(holders, 0, sizeof(holders));
+  lastFrame = usbFrame();
+}
+
+bool mouseKeysBinding(uint16_t binding) {
+  return macroByte(binding) == OP_MOUSE_KEYS;
+}
+
+void mouseKeysKey(uint16_t binding, bool press) {
+  if (!mouseKeysBinding(binding)) {
+    return;
+  }
+  uint8_t directions = macroByte(binding + 1);
+  for (uint8_t i = 0; i < 8; i++) {
+    if (directions & (1 << i)) {
+      if (press) {
+        holders[i]++;
+      } else if (holders[i]) {
+        holders[i]--;
+      }
+      if (holders[i]) {
+        held |= 1 << i;
+      } else {
+        held &= ~(1 << i);
+      }
+    }
+  }
+}
+
+void mouseKeysRun() {
+  uint8_t frame = usbFrame();
+  uint8_t frames = frame - lastFrame;
+  lastFrame = frame;
+  if ((!held) && (!move.speed) && (!scroll.speed)) {
+    return;
+  }
+  for (; frames; frames--) {
+    int8_t x, y;
+    if (motionStep(&move, held & MOUSE_KEY_MOVES, axis(MOUSE_KEY_LEFT, MOUSE_KEY_RIGHT), axis(MOUSE_KEY_UP, MOUSE_KEY_DOWN),
+                   MOUSEKEYS_MOVE_START, MOUSEKEYS_MOVE_MAX, MOUSEKEYS_MOVE_ACCEL, &x, &y) && ((x) || (y))) {
+      reportMouseMove(x, y);
+    }
+    if (motionStep(&scroll, held & MOUSE_KEY_SCROLLS, axis(MOUSE_KEY_PAN_LEFT, MOUSE_KEY_PAN_RIGHT),
+                   axis(MOUSE_KEY_WHEEL_DOWN, MOUSE_KEY_WHEEL_UP), MOUSEKEYS_WHEEL_START, MOUSEKEYS_WHEEL_MAX,
+                   MOUSEKEYS_WHEEL_ACCEL, &x, &y) && ((x) || (y))) {
+      reportMouseScroll(y, x);
+    }
+  }
+}
+
+bool mouseKeysBusy() {
+  return held;
+}
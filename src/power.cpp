@@ -0,0 +1,140 @@
+#include "power.h"
+#include "keyscan.h"
+#include "rotary.h"
+#include "stats.h"
+#include <avr/sleep.h>
+
+#define NO_INTERRUPT 0xFF
+
+#define WAKE_KEYS 0x01
+#define WAKE_ENCODER 0x02
+
+// External interrupt INTn of the pin
+constexpr uint8_t pinExtInt(uint8_t pin) {
+  return ((pinPort(pin) == PORT_D) && ((pinMap[pin] & 7) <= 3)) ? (pinMap[pin] & 7)
+         : ((pinPort(pin) == PORT_E) && ((pinMap[pin] & 7) == 6)) ? 6
+         : NO_INTERRUPT;
+}
+
+// Bit of the pin in EIMSK
+constexpr uint8_t extIntMask(uint8_t pin) {
+  return (pinExtInt(pin) != NO_INTERRUPT) ? (1 << pinExtInt(pin)) : 0;
+}
+
+// Bit of the pin in PCMSK0, only port B has pin change interrupts
+constexpr uint8_t pcIntMask(uint8_t pin) {
+  return (pinPort(pin) == PORT_B) ? pinBit(pin) : 0;
+}
+
+constexpr uint8_t keysExtIntMask() {
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < NUMBER_OF_KEY_INPUTS; i++) {
+    mask |= extIntMask(keyInputPin[i]);
+  }
+  return mask;
+}
+
+constexpr uint8_t keysPcIntMask() {
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < NUMBER_OF_KEY_INPUTS; i++) {
+    mask |= pcIntMask(keyInputPin[i]);
+  }
+  return mask;
+}
+
+constexpr uint8_t encoderExtIntMask() {
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < sizeof(encoderPin); i++) {
+    mask |= extIntMask(encoderPin[i]);
+  }
+  return mask;
+}
+
+constexpr uint8_t encoderPcIntMask() {
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < sizeof(encoderPin); i++) {
+    mask |= pcIntMask(encoderPin[i]);
+  }
+  return mask;
+}
+
+// Encoder pins whose edge fires INTn, bit i for encoderPin[i] as rotaryInterrupt() takes them
+constexpr uint16_t encoderExtIntPins(uint8_t n) {
+  uint16_t pins = 0;
+  for (uint8_t i = 0; i < sizeof(encoderPin); i++) {
+    pins |= (extIntMask(encoderPin[i]) & _BV(n)) ? (1 << i) : 0;
+  }
+  return pins;
+}
+
+// Encoder pins on the pin change interrupt, it does not tell which one fired
+constexpr uint16_t encoderPcIntPins() {
+  uint16_t pins = 0;
+  for (uint8_t i = 0; i < sizeof(encoderPin); i++) {
+    pins |= pcIntMask(encoderPin[i]) ? (1 << i) : 0;
+  }
+  return pins;
+}
+
+static volatile uint8_t wakeEvents;
+
+// A key edge only wakes the MCU and marks the source, the keys are read by the main loop. The
+// encoder is decoded right away, its steps are too short to wait for the loop.
+static inline void pinEvent(uint8_t events, uint16_t encoderPins) {
+  if (encoderPins) {
+    uint32_t start = statsCycles();
+    rotaryInterrupt(encoderPins);
+    statsSince(STATS_ISR, start);
+  }
+  wakeEvents |= events;
+}
+
+ISR(PCINT0_vect) {
+  pinEvent((keysPcIntMask() ? WAKE_KEYS : 0) | (encoderPcIntMask() ? WAKE_ENCODER : 0), encoderPcIntPins());
+}
+
+#define EXT_INT_ISR(n)                                                                              \
+  ISR(INT##n##_vect) {                                                                              \
+    pinEvent(((keysExtIntMask() & _BV(n)) ? WAKE_KEYS : 0) | ((encoderExtIntMask() & _BV(n)) ? WAKE_ENCODER : 0), \
+             encoderExtIntPins(n));                                                                 \
+  }
+
+EXT_INT_ISR(0)
+EXT_INT_ISR(1)
+EXT_INT_ISR(2)
+EXT_INT_ISR(3)
+EXT_INT_ISR(6)
+
+void powerBegin() {
+  uint8_t extMask = keysExtIntMask() | encoderExtIntMask();
+  uint8_t pcMask = keysPcIntMask() | encoderPcIntMask();
+  // any edge on INT0 - INT3 and INT6
+  EICRA = (extMask & 0x0F) ? (_BV(ISC00) | _BV(ISC10) | _BV(ISC20) | _BV(ISC30)) : 0;
+  EICRB = _BV(ISC60);
+  EIFR = extMask;
+  EIMSK = extMask;
+  PCMSK0 = pcMask;
+  PCIFR = _BV(PCIF0);
+  PCICR = pcMask ? _BV(PCIE0) : 0;
+}
+
+void powerSleep(bool busy) {
+  uint8_t events;
+  cli();
+  events = wakeEvents;
+  wakeEvents = 0;
+  sei();
+
+  if ((!SLEEP_WHEN_IDLE) || (busy) || (events)) {
+    return;
+  }
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  cli();
+  if (!wakeEvents) {
+    sleep_enable();
+    sei(); // the instruction after sei is executed before any interrupt, so no edge is lost
+    sleep_cpu();
+    sleep_disable();
+  }
+  sei();
+}
@@ -0,0 +1,177 @@
+#include "report.h"
+#include "hidqueue.h"
+#include "stats.h"
+
+#define KEYBOARD_KEYS 6 // key codes of the HID-Project keyboard report
+#define CONSUMER_KEYS 4 // key codes of the HID-Project consumer report
+
+typedef struct TKeyboardReports {
+  uint8_t modifiers;
+  uint8_t reserved;
+  uint8_t keys[KEYBOARD_KEYS];
+} TKeyboardReport;
+
+typedef struct TConsumerReports {
+  uint16_t keys[CONSUMER_KEYS];
+} TConsumerReport;
+
+static TKeyboardReport keyboard, keyboardQueued;
+static uint8_t keyHolds[KEYBOARD_KEYS]; // presses not released yet of the key codes in keyboard.keys[]
+static uint8_t modifierHolds[8];        // the same for every modifier bit
+static TConsumerReport consumer, consumerQueued;
+static uint8_t consumerHolds[CONSUMER_KEYS];
+static uint8_t systemKey, systemQueued;
+static uint8_t mouseButtons, mouseQueued;
+static uint8_t buttonHolds[8];
+static int16_t mouseX, mouseY;       // moves not sent yet
+static int16_t mouseWheel, mousePan; // scrolls not sent yet
+static uint8_t count;
+
+// Counts a press or a release of every bit set in bits, returns held with the bits that have
+// presses left set and the others cleared
+static uint8_t holdBits(uint8_t *holds, uint8_t held, uint8_t bits, bool press) {
+  for (uint8_t i = 0; i < 8; i++) {
+    if (bits & (1 << i)) {
+      if (press) {
+        holds[i]++;
+      } else if (holds[i]) {
+        holds[i]--;
+      }
+      if (holds[i]) {
+        held |= 1 << i;
+      } else {
+        held &= ~(1 << i);
+      }
+    }
+  }
+  return held;
+}
+
+void reportKeyboardPress(KeyboardKeycode key) {
+  if ((key >= KEY_LEFT_CTRL) && (key <= KEY_RIGHT_GUI)) {
+    keyboard.modifiers = holdBits(modifierHolds, keyboard.modifiers, 1 << (key - KEY_LEFT_CTRL), true);
+    return;
+  }
+  int8_t lfree = -1;
+  for (uint8_t i = 0; i < KEYBOARD_KEYS; i++) {
+    if (keyboard.keys[i] == key) {
+      keyHolds[i]++;
+      return;
+    }
+    if ((lfree < 0) && (keyboard.keys[i] == KEY_RESERVED)) {
+      lfree = i;
+    }
+  }
+  if (lfree >= 0) {
+    keyboard.keys[lfree] = key;
+    keyHolds[lfree] = 1;
+  }
+}
+
+void reportKeyboardRelease(KeyboardKeycode key) {
+  if ((key >= KEY_LEFT_CTRL) && (key <= KEY_RIGHT_GUI)) {
+    keyboard.modifiers = holdBits(modifierHolds, keyboard.modifiers, 1 << (key - KEY_LEFT_CTRL), false);
+    return;
+  }
+  for (uint8_t i = 0; i < KEYBOARD_KEYS; i++) {
+    if ((keyboard.keys[i] == key) && (--keyHolds[i] == 0)) {
+      keyboard.keys[i] = KEY_RESERVED;
+    }
+  }
+}
+
+void reportConsumerPress(ConsumerKeycode key) {
+  int8_t lfree = -1;
+  for (uint8_t i = 0; i < CONSUMER_KEYS; i++) {
+    if (consumer.keys[i] == key) {
+      consumerHolds[i]++;
+      return;
+    }
+    if ((lfree < 0) && (consumer.keys[i] == HID_CONSUMER_UNASSIGNED)) {
+      lfree = i;
+    }
+  }
+  if (lfree >= 0) {
+    consumer.keys[lfree] = key;
+    consumerHolds[lfree] = 1;
+  }
+}
+
+void reportConsumerRelease(ConsumerKeycode key) {
+  for (uint8_t i = 0; i < CONSUMER_KEYS; i++) {
+    if ((consumer.keys[i] == key) && (--consumerHolds[i] == 0)) {
+      consumer.keys[i] = HID_CONSUMER_UNASSIGNED;
+    }
+  }
+}
+
+void reportSystemPress(SystemKeycode key) {
+  systemKey = key;
+}
+
+void reportSystemRelease(SystemKeycode key) {
+  if (systemKey == key) {
+    systemKey = 0;
+  }
+}
+
+void reportMousePress(uint8_t buttons) {
+  mouseButtons = holdBits(buttonHolds, mouseButtons, buttons, true);
+}
+
+void reportMouseRelease(uint8_t buttons) {
+  mouseButtons = holdBits(buttonHolds, mouseButtons, buttons, false);
+}
+
+void reportMouseMove(int8_t x, int8_t y) {
+  mouseX = constrain(mouseX + x, -32767, 32767);
+  mouseY = constrain(mouseY + y, -32767, 32767);
+}
+
+void reportMouseScroll(int16_t wheel, int16_t pan) {
+  mouseWheel = constrain((long)mouseWheel + wheel, -32767, 32767);
+  mousePan = constrain((long)mousePan + pan, -32767, 32767);
+}
+
+void reportSend() {
+  bool queued = false;
+  if (memcmp(&keyboard, &keyboardQueued, sizeof(keyboard)) != 0) {
+    hidQueuePush(HID_QUEUE_KEYBOARD, &keyboard);
+    keyboardQueued = keyboard;
+    queued = true;
+  }
+  if (memcmp(&consumer, &consumerQueued, sizeof(consumer)) != 0) {
+    hidQueuePush(HID_QUEUE_CONSUMER, &consumer);
+    consumerQueued = consumer;
+    queued = true;
+  }
+  if (systemKey != systemQueued) {
+    hidQueuePush(HID_QUEUE_SYSTEM, &systemKey);
+    systemQueued = systemKey;
+    queued = true;
+  }
+  if ((mouseButtons != mouseQueued) || (mouseX) || (mouseY) || (mouseWheel) || (mousePan)) {
+    // a move beyond the report range goes on in the next report
+    THidQueueMouse mouse = {mouseButtons, (int8_t)constrain(mouseX, -127, 127), (int8_t)constrain(mouseY, -127, 127),
+                            mouseWheel, mousePan};
+    if (hidQueuePush(HID_QUEUE_MOUSE, &mouse)) {
+      mouseQueued = mouseButtons;
+      mouseX -= mouse.x;
+      mouseY -= mouse.y;
+      mouseWheel = 0;
+      mousePan = 0;
+      queued = true;
+    }
+  }
+  statsReportQueued(queued);
+  count++;
+}
+
+uint8_t reportCount() {
+  return count;
+}
+
+bool reportReady() {
+  return hidQueueEmpty(HID_QUEUE_KEYBOARD) && hidQueueEmpty(HID_QUEUE_CONSUMER) && hidQueueEmpty(HID_QUEUE_SYSTEM) &&
+         hidQueueEmpty(HID_QUEUE_MOUSE);
+}
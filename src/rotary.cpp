@@ -0,0 +1,173 @@
+#include "rotary.h"
+#include "keyscan.h"
+
+#define ENCODER_PIN_MASK ((1 << ENCODER_PINS) - 1)
+
+static_assert(sizeof(encoderPin) <= 16, "the pins of all encoders fit the 16 bits of rotaryInterrupt()");
+
+// Step of the transition from the state (DT << 1 | CLK, active high) in the high bits to the state
+// in the low bits. Clockwise CLK leads: 00 -> 01 -> 11 -> 10. Both bits changing is 0 here.
+static const int8_t transition[16] = {
+  0, 1, -1, 0,
+  -1, 0, 0, 1,
+  1, 0, 0, -1,
+  0, -1, 1, 0,
+};
+
+// Interrupt side of an encoder
+typedef struct TRotaryInputs {
+  uint8_t state;     // last decoded pin state
+  int8_t direction;  // of the last step
+  int16_t delta;     // steps rotaryRead() did not take yet
+  uint16_t stepMs;   // low bits of millis() at the last step
+  bool button;       // last sampled button level
+  uint16_t buttonMs; // low bits of millis() at the last button edge
+} TRotaryInput;
+
+// Loop side of an encoder
+typedef struct TRotaryButtons {
+  bool debounced;
+  bool held;         // ROTARY_HOLD sent for this press
+  bool clickPending; // waits for a possible second click
+  uint32_t pressMs, clickMs;
+} TRotaryButton;
+
+static volatile TRotaryInput input[NUMBER_OF_ENCODERS];
+static TRotaryButton button[NUMBER_OF_ENCODERS];
+
+// Pins of all encoders, bit ENCODER_PINS * encoder + pin is set when the pin is low
+static inline uint16_t readPins() {
+  uint8_t snapshot[PORT_COUNT];
+  readPorts<encoderPin, sizeof(encoderPin)>(snapshot);
+  return TPinGather<uint16_t, encoderPin, sizeof(encoderPin)>::gatherLow(snapshot);
+}
+
+// Decodes the pins of all encoders, interrupts are off
+static void sample(uint16_t fired) {
+  uint16_t active = readPins();
+  uint16_t nowMs = millis();
+  for (uint8_t e = 0; e < NUMBER_OF_ENCODERS; e++, active >>= ENCODER_PINS, fired >>= ENCODER_PINS) {
+    volatile TRotaryInput *in = &input[e];
+    uint8_t now = active & (ROTARY_DT | ROTARY_CLK);
+    uint8_t changed = in->state ^ now;
+    if (changed == 3) {
+      // both pins moved since the last sample: the one that did not fire moved first, from the
+      // loop poll the rotation went on in the same direction
+      uint8_t first = (fired & ROTARY_DT) && !(fired & ROTARY_CLK) ? 1 : (fired & ROTARY_CLK) && !(fired & ROTARY_DT) ? 2 : 0;
+      if (first) {
+        uint8_t middle = in->state ^ first;
+        int8_t steps = transition[(in->state << 2) | middle] + transition[(middle << 2) | now];
+        in->delta += steps;
+        in->direction = steps > 0 ? 1 : -1;
+      } else {
+        in->delta += 2 * in->direction;
+      }
+    }
+    else if (changed) {
+      in->direction = transition[(in->state << 2) | now];
+      in->delta += in->direction;
+    }
+    if (changed) {
+      in->stepMs = nowMs;
+    }
+    in->state = now;
+
+    bool pressed = active & ROTARY_SW;
+    if (pressed != in->button) {
+      in->button = pressed;
+      in->buttonMs = nowMs;
+    }
+  }
+}
+
+void rotaryBegin() {
+  for (uint8_t i = 0; i < sizeof(encoderPin); i++) {
+    pinMode(encoderPin[i], INPUT_PULLUP);
+  }
+  uint16_t active = readPins();
+  for (uint8_t e = 0; e < NUMBER_OF_ENCODERS; e++, active >>= ENCODER_PINS) {
+    input[e].state = active & (ROTARY_DT | ROTARY_CLK);
+    input[e].direction = 1;
+    input[e].delta = 0;
+    input[e].button = button[e].debounced = active & ROTARY_SW;
+  }
+}
+
+void rotaryInterrupt(uint16_t pins) {
+  sample(pins);
+}
+
+void rotaryPoll() {
+  uint8_t sreg = SREG;
+  cli();
+  sample(0);
+  SREG = sreg;
+}
+
+// Button event of the encoder, a click is a release not held too long, it waits for a possible
+// second one
+static bool buttonEvent(uint8_t e, bool level, uint32_t edgeMs, TRotaryEvent *event, uint32_t now) {
+  TRotaryButton *b = &button[e];
+  if ((level != b->debounced) && ((now - edgeMs) >= ROTARY_BUTTON_DEBOUNCE_MS)) {
+    b->debounced = level;
+    if (level) {
+      b->pressMs = edgeMs;
+      b->held = false;
+    }
+    else if ((b->held) || ((edgeMs - b->pressMs) > ROTARY_HOLD_MS)) {
+      b->clickPending = false;
+    }
+    else if ((b->clickPending) && ((edgeMs - b->clickMs) <= ROTARY_DOUBLE_CLICK_MS)) {
+      b->clickPending = false;
+      *event = {ROTARY_DOUBLE_CLICK, e, 0, edgeMs};
+      return true;
+    }
+    else {
+      b->clickPending = true;
+      b->clickMs = edgeMs;
+    }
+  }
+  if ((b->debounced) && (!b->held) && ((now - b->pressMs) > ROTARY_HOLD_MS)) {
+    b->held = true;
+    b->clickPending = false;
+    *event = {ROTARY_HOLD, e, 0, b->pressMs + ROTARY_HOLD_MS};
+    return true;
+  }
+  if ((b->clickPending) && (!b->debounced) && ((now - b->clickMs) > ROTARY_DOUBLE_CLICK_MS)) {
+    b->clickPending = false;
+    *event = {ROTARY_CLICK, e, 0, b->clickMs};
+    return true;
+  }
+  return false;
+}
+
+bool rotaryRead(TRotaryEvent *event, uint32_t now) {
+  for (uint8_t e = 0; e < NUMBER_OF_ENCODERS; e++) {
+    uint8_t sreg = SREG;
+    cli();
+    int16_t steps = input[e].delta;
+    uint16_t stepMs = input[e].stepMs;
+    input[e].delta = 0;
+    bool level = input[e].button;
+    uint16_t edgeMs = input[e].buttonMs;
+    SREG = sreg;
+
+    if (steps) {
+      *event = {ROTARY_STEP, e, steps, now - (uint16_t)((uint16_t)now - stepMs)};
+      return true;
+    }
+    if (buttonEvent(e, level, now - (uint16_t)((uint16_t)now - edgeMs), event, now)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool rotaryBusy() {
+  for (uint8_t e = 0; e < NUMBER_OF_ENCODERS; e++) {
+    if ((input[e].delta) || (input[e].button != button[e].debounced)) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,163 @@
+#include <HID-Project.h>
+#include <HMouse.h>
+#include "sequencer.h"
+#include "macro.h"
+#include "report.h"
+
+#define SEQUENCE_FREE 0xFF // keyIndex of unused slot
+
+typedef struct TSequences {
+  uint8_t keyIndex; // key whose sequence is played, SEQUENCE_FREE if the slot is unused
+  uint16_t binding; // first operation of the sequence
+  uint16_t stepPos; // first operation of the played step
+  bool pressed;     // keys of the step are held down, waiting for release
+  uint8_t sent;     // reportCount() of the last press or release
+  uint32_t dueMs;   // time of the next press or release event
+} TSequence;
+
+static TSequence sequence[SEQUENCER_SLOTS];
+
+// Press or release keys held down for the whole sequence
+static void sendMods(uint16_t pos, bool press) {
+  for (uint8_t op = macroByte(pos); op != OP_END; pos = macroNext(pos), op = macroByte(pos)) {
+    if (op == OP_MOD) {
+      if (press) {
+        reportKeyboardPress((KeyboardKeycode)macroByte(pos + 1));
+      } else {
+        reportKeyboardRelease((KeyboardKeycode)macroByte(pos + 1));
+      }
+    }
+  }
+}
+
+// Press or release keys of the step starting at pos. Returns position after the step and its
+// duration. A step not finished by OP_TAP / OP_PRESS is a tap ending at OP_END. Moves and
+// scrolls happen with the press.
+static uint16_t sendStep(uint16_t pos, bool press, uint16_t *durationMs) {
+  *durationMs = 0;
+  for (uint8_t op = macroByte(pos); op != OP_END; pos = macroNext(pos), op = macroByte(pos)) {
+    switch (op) {
+      case OP_KEY:
+        if (press) {
+          reportKeyboardPress((KeyboardKeycode)macroByte(pos + 1));
+        } else {
+          reportKeyboardRelease((KeyboardKeycode)macroByte(pos + 1));
+        }
+        break;
+      case OP_CONSUMER:
+        if (press) {
+          reportConsumerPress((ConsumerKeycode)macroWord(pos + 1));
+        } else {
+          reportConsumerRelease((ConsumerKeycode)macroWord(pos + 1));
+        }
+        break;
+      case OP_SYSTEM:
+        if (press) {
+          reportSystemPress((SystemKeycode)macroByte(pos + 1));
+        } else {
+          reportSystemRelease((SystemKeycode)macroByte(pos + 1));
+        }
+        break;
+      case OP_MOUSE_BUTTON:
+        if (press) {
+          reportMousePress(macroByte(pos + 1));
+        } else {
+          reportMouseRelease(macroByte(pos + 1));
+        }
+        break;
+      case OP_MOUSE_MOVE:
+        if (press) {
+          reportMouseMove(macroByte(pos + 1), macroByte(pos + 2));
+        }
+        break;
+      case OP_MOUSE_SCROLL:
+        if (press) {
+          reportMouseScroll((int8_t)macroByte(pos + 1) * HMOUSE_HIRES_RESOLUTION, (int8_t)macroByte(pos + 2) * HMOUSE_HIRES_RESOLUTION);
+        }
+        break;
+      case OP_PRESS:
+        *durationMs = macroWord(pos + 1);
+        return macroNext(pos);
+      case OP_TAP:
+        return macroNext(pos);
+    }
+  }
+  return pos;
+}
+
+// Process the next event of the sequence if it is due. Every press and release goes to its own
+// report, so the host sees all of them even for steps without duration. The next event waits
+// until the host got the reports, so sequences play at the host polling rate and never pile up
+// in the report queues.
+static void advance(TSequence *seq, uint32_t now) {
+  if (((int32_t)(now - seq->dueMs) < 0) || (seq->sent == reportCount()) || (!reportReady())) {
+    return;
+  }
+  if (macroByte(seq->stepPos) == OP_END) {
+    // the slot is freed once the last release went out, the same key started again right away
+    // would otherwise press in the report releasing it
+    seq->keyIndex = SEQUENCE_FREE;
+    return;
+  }
+  seq->sent = reportCount();
+  uint16_t durationMs;
+  if (seq->pressed) {
+    seq->stepPos = sendStep(seq->stepPos, false, &durationMs);
+    seq->pressed = false;
+    if (macroByte(seq->stepPos) == OP_END) {
+      // end of the sequence, keys held for the whole sequence go up with the last step
+      sendMods(seq->binding, false);
+    }
+  } else {
+    sendStep(seq->stepPos, true, &durationMs);
+    seq->pressed = true;
+    seq->dueMs = now + durationMs;
+  }
+}
+
+void sequencerBegin() {
+  for (uint8_t i = 0; i < SEQUENCER_SLOTS; i++) {
+    sequence[i].keyIndex = SEQUENCE_FREE;
+  }
+}
+
+bool sequencerStart(uint8_t keyIndex, uint16_t binding, uint32_t now) {
+  TSequence *lfree = NULL;
+  for (uint8_t i = 0; i < SEQUENCER_SLOTS; i++) {
+    if (sequence[i].keyIndex == keyIndex) {
+      return false; // still playing, a repeated press is skipped the same way as while delay() blocked
+    }
+    if ((!lfree) && (sequence[i].keyIndex == SEQUENCE_FREE)) {
+      lfree = &sequence[i];
+    }
+  }
+  if (!lfree) {
+    return false;
+  }
+  sendMods(binding, true);
+  lfree->keyIndex = keyIndex;
+  lfree->binding = binding;
+  lfree->stepPos = binding;
+  lfree->pressed = false;
+  lfree->sent = reportCount() - 1;
+  lfree->dueMs = now;
+  advance(lfree, now);
+  return true;
+}
+
+void sequencerRun(uint32_t now) {
+  for (uint8_t i = 0; i < SEQUENCER_SLOTS; i++) {
+    if (sequence[i].keyIndex != SEQUENCE_FREE) {
+      advance(&sequence[i], now);
+    }
+  }
+}
+
+bool sequencerBusy() {
+  for (uint8_t i = 0; i < SEQUENCER_SLOTS; i++) {
+    if (sequence[i].keyIndex != SEQUENCE_FREE) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,103 @@
+#ifdef STATS
+
+#include "stats.h"
+
+static TConfigStats stats;
+static volatile uint16_t overflows; // high word of statsCycles()
+static uint32_t clearMs;
+static uint32_t keyEventCycles;
+static bool keyEventPending;
+static bool keyEventQueued; // the key change made a report
+
+ISR(TIMER3_OVF_vect) {
+  overflows++;
+}
+
+void statsBegin() {
+  TCCR3A = 0;
+  TCCR3B = _BV(CS30); // no prescaler
+  TIMSK3 = _BV(TOIE3);
+  statsClear();
+}
+
+uint32_t statsCycles() {
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t low = TCNT3;
+  uint16_t high = overflows;
+  if ((TIFR3 & _BV(TOV3)) && (low < 0x8000)) {
+    high++; // overflow not served yet, interrupts are off
+  }
+  SREG = sreg;
+  return ((uint32_t)high << 16) | low;
+}
+
+void statsRecord(enum TStatsHistogram histogram, uint32_t cycles) {
+  TConfigHistogram *h = &stats.histogram[histogram];
+  uint8_t bucket = 0;
+  for (uint32_t v = cycles >> STATS_BUCKET_SHIFT; (v) && (bucket < STATS_BUCKETS - 1); v >>= 1) {
+    bucket++;
+  }
+  if (h->bucket[bucket] != 0xFFFF) {
+    h->bucket[bucket]++;
+  }
+  if ((h->count == 0) || (cycles < h->min)) {
+    h->min = cycles;
+  }
+  if (cycles > h->max) {
+    h->max = cycles;
+  }
+  h->sum += cycles;
+  h->count++;
+}
+
+void statsSince(enum TStatsHistogram histogram, uint32_t start) {
+  statsRecord(histogram, statsCycles() - start);
+}
+
+void statsCount(enum TStatsCounter counter, uint16_t n) {
+  stats.counter[counter] += n;
+}
+
+void statsKeyEvent() {
+  if (!keyEventPending) {
+    keyEventCycles = statsCycles();
+    keyEventPending = true;
+  }
+}
+
+void statsReportQueued(bool queued) {
+  if ((keyEventPending) && (!keyEventQueued)) {
+    keyEventPending = queued;
+    keyEventQueued = queued;
+  }
+}
+
+void statsReportSent() {
+  if (keyEventQueued) {
+    statsSince(STATS_LATENCY, keyEventCycles);
+    keyEventPending = false;
+    keyEventQueued = false;
+  }
+}
+
+void statsRead(uint16_t offset, uint8_t length, void *data) {
+  stats.uptimeMs = millis() - clearMs;
+  uint8_t sreg = SREG;
+  cli(); // STATS_ISR changes in the interrupt
+  memcpy(data, (const uint8_t *)&stats + offset, length);
+  SREG = sreg;
+}
+
+void statsClear() {
+  uint8_t sreg = SREG;
+  cli();
+  memset(&stats, 0, sizeof(stats));
+  SREG = sreg;
+  stats.cpuHz = F_CPU;
+  clearMs = millis();
+  keyEventPending = false;
+  keyEventQueued = false;
+}
+
+#endif
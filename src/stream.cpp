@@ -0,0 +1,89 @@
+#include <HID-Project.h>
+#include "stream.h"
+#include "report.h"
+
+static_assert((STREAM_BUFFER & (STREAM_BUFFER - 1)) == 0, "STREAM_BUFFER must be a power of 2");
+static_assert(STREAM_BUFFER < 256, "STREAM_BUFFER does not fit the uint8_t ring indices");
+
+typedef struct TStreamKeys {
+  uint8_t modifiers; // modifier bits of the keyboard report
+  uint8_t code;      // 0 for modifiers alone
+} TStreamKey;
+
+static TStreamKey buffer[STREAM_BUFFER];
+static uint8_t head, tail;
+static TStreamKey held; // key down
+static bool down;
+static uint8_t sent; // reportCount() of the last press or release
+
+static void send(TStreamKey key, bool press) {
+  for (uint8_t bit = 0; bit < 8; bit++) {
+    if (key.modifiers & (1 << bit)) {
+      if (press) {
+        reportKeyboardPress((KeyboardKeycode)(KEY_LEFT_CTRL + bit));
+      } else {
+        reportKeyboardRelease((KeyboardKeycode)(KEY_LEFT_CTRL + bit));
+      }
+    }
+  }
+  if (key.code) {
+    if (press) {
+      reportKeyboardPress((KeyboardKeycode)key.code);
+    } else {
+      reportKeyboardRelease((KeyboardKeycode)key.code);
+    }
+  }
+}
+
+bool streamWrite(const uint8_t *pairs, uint8_t count) {
+  if (count > streamFree()) {
+    return false;
+  }
+  if (!streamBusy()) {
+    sent = reportCount() - 1; // the first key goes to the report of this pass
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    buffer[head & (STREAM_BUFFER - 1)] = {pairs[2 * i], pairs[2 * i + 1]};
+    head++;
+  }
+  return true;
+}
+
+uint8_t streamFree() {
+  return STREAM_BUFFER - (uint8_t)(head - tail);
+}
+
+uint8_t streamPending() {
+  return (uint8_t)(head - tail) + (down ? 1 : 0);
+}
+
+// One press or release per report, the next waits until the host got the last one like the
+// steps of the sequencer
+void streamRun() {
+  if ((sent == reportCount()) || (!reportReady()) || (!streamBusy())) {
+    return;
+  }
+  sent = reportCount();
+  TStreamKey next = buffer[tail & (STREAM_BUFFER - 1)];
+  if (down) {
+    if ((head != tail) && (next.modifiers == held.modifiers) && (next.code != held.code)) {
+      // rollover: the modifiers stay, the next key goes down with the release of this one
+      send({0, held.code}, false);
+      send({0, next.code}, true);
+      held = next;
+      tail++;
+    } else {
+      send(held, false);
+      down = false;
+    }
+  } else {
+    send(next, true);
+    held = next;
+    down = true;
+    tail++;
+  }
+}
+
+bool streamBusy() {
+  return (down) || (head != tail);
+}
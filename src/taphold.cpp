@@ -0,0 +1,172 @@
+#include "taphold.h"
+#include "layer.h"
+#include "macro.h"
+#include "report.h"
+#include "sequencer.h"
+#include "stats.h"
+
+static_assert((TAP_HOLD_BUFFER & (TAP_HOLD_BUFFER - 1)) == 0, "TAP_HOLD_BUFFER must be a power of 2");
+
+#define NO_KEY 0xFF
+
+typedef struct TTapHoldEvents {
+  uint8_t keyIndex;
+  bool down;
+  uint32_t timeMs;
+} TTapHoldEvent;
+
+static TTapHoldEvent event[TAP_HOLD_BUFFER];
+static uint8_t head, tail;
+static TKeyMask last;                      // debounced keys of the last call
+static TKeyMask logical;                   // keys as the key state machine sees them
+static TKeyMask holding;                   // tap-hold keys decided as hold and not released yet
+static uint16_t holdBinding[NUMBER_OF_KEYS_AND_COMBOS]; // binding of the holding keys
+static uint8_t pending = NO_KEY;           // tap-hold key waiting for its decision
+static uint16_t pendingBinding;
+static uint32_t pendingMs;
+
+static bool holdKey(uint16_t binding) {
+  uint8_t op = macroByte(binding);
+  return (op == OP_HOLD_MOD) || (op == OP_HOLD_LAYER);
+}
+
+static void hold(uint16_t binding, bool press) {
+  if (macroByte(binding) == OP_HOLD_MOD) {
+    if (press) {
+      reportKeyboardPress((KeyboardKeycode)macroByte(binding + 1));
+    } else {
+      reportKeyboardRelease((KeyboardKeycode)macroByte(binding + 1));
+    }
+  } else {
+    layerHold(macroByte(binding + 1), press);
+  }
+}
+
+// Looks at the changes after the press of the pending key, false while they do not decide it
+static bool decide(uint32_t now, bool force) {
+  TKeyMask down = 0; // other keys pressed since
+  bool isHold = force;
+  bool isTap = false;
+  for (uint8_t i = head; (!isHold) && (!isTap) && (i != tail); i++) {
+    const TTapHoldEvent *e = &event[i & (TAP_HOLD_BUFFER - 1)];
+    TKeyMask bit = (TKeyMask)1 << e->keyIndex;
+    if ((e->timeMs - pendingMs) >= TAP_HOLD_TERM_MS) {
+      isHold = true;
+    }
+    else if (e->keyIndex == pending) {
+      isTap = true;
+    }
+    else if (e->down) {
+      down |= bit;
+      isHold = TAP_HOLD_ON_OTHER_PRESS;
+    }
+    else if (down & bit) {
+      isHold = TAP_HOLD_PERMISSIVE;
+    }
+  }
+  if ((!isTap) && ((now - pendingMs) >= TAP_HOLD_TERM_MS)) {
+    isHold = true;
+  }
+
+  if (isHold) {
+    holding |= (TKeyMask)1 << pending;
+    holdBinding[pending] = pendingBinding;
+    hold(pendingBinding, true);
+  }
+  else if (isTap) {
+    // the hold operation is skipped by the sequencer, it plays the rest of the binding
+    if (!sequencerStart(pending, pendingBinding, now)) {
+      return false; // no free slot, try again in the next pass
+    }
+    layerKeyDone();
+  }
+  else {
+    return false;
+  }
+  statsKeyEvent();
+  pending = NO_KEY;
+  return true;
+}
+
+// Takes the oldest buffered change
+static void apply() {
+  const TTapHoldEvent *e = &event[head & (TAP_HOLD_BUFFER - 1)];
+  TKeyMask bit = (TKeyMask)1 << e->keyIndex;
+  head++;
+  if (holding & bit) {
+    if (!e->down) {
+      holding &= ~bit;
+      hold(holdBinding[e->keyIndex], false);
+    }
+  }
+  else if ((e->down) && (holdKey(macroBinding(e->keyIndex)))) {
+    pending = e->keyIndex;
+    pendingBinding = macroBinding(e->keyIndex);
+    pendingMs = e->timeMs;
+  }
+  else if (e->down) {
+    logical |= bit;
+  }
+  else {
+    logical &= ~bit; // also the release of a tapped key, which was never down here
+  }
+}
+
+// Hands the buffered changes to the key state machine until one waits for a decision
+static void replay(uint32_t now) {
+  TKeyMask changed = 0;
+  for (;;) {
+    if (pending != NO_KEY) {
+      TKeyMask key = (TKeyMask)1 << pending;
+      if (!decide(now, false)) {
+        return;
+      }
+      if (!(holding & key)) {
+        return; // a tap, its press goes to the host before the changes that followed it
+      }
+    }
+    if (head == tail) {
+      return;
+    }
+    TKeyMask bit = (TKeyMask)1 << event[head & (TAP_HOLD_BUFFER - 1)].keyIndex;
+    if (changed & bit) {
+      return; // the key state machine works on levels, one change per key and pass
+    }
+    changed |= bit;
+    apply();
+  }
+}
+
+void tapHoldBegin() {
+  head = tail = 0;
+  last = logical = holding = 0;
+  pending = NO_KEY;
+}
+
+TKeyMask tapHold(TKeyMask pressed, uint32_t now) {
+  TKeyMask changed = pressed ^ last;
+  last = pressed;
+  for (uint8_t i = 0; changed; i++, changed >>= 1) {
+    if (!(changed & 1)) {
+      continue;
+    }
+    if ((uint8_t)(tail - head) == TAP_HOLD_BUFFER) {
+      // typing on while a tap-hold key is down, it is a hold
+      if (pending != NO_KEY) {
+        decide(now, true);
+      }
+      replay(now);
+      if ((uint8_t)(tail - head) == TAP_HOLD_BUFFER) {
+        apply(); // the key state machine misses this level of the key
+      }
+    }
+    event[tail & (TAP_HOLD_BUFFER - 1)] = {i, (bool)(pressed & ((TKeyMask)1 << i)), now};
+    tail++;
+  }
+  replay(now);
+  return logical;
+}
+
+bool tapHoldBusy() {
+  return (pending != NO_KEY) || (head != tail) || (holding);
+}
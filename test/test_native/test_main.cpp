@@ -0,0 +1,607 @@
+/*
+  test_main.cpp
+
+  Tests of the firmware logic on the host, against the stand-ins in lib/NativeHAL:
+
+    pio test -e native
+
+  Every test starts from a blank EEPROM and setup(), the keys go up again in tearDown().
+*/
+
+#include <unity.h>
+#include <HID-Project.h>
+#include <HMouse.h>
+#include <HRawHID.h>
+#include <util/crc16.h>
+#include "NativeHAL.h"
+#include "configprotocol.h"
+#include "debounce.h"
+#include "hidqueue.h"
+#include "keypad.h"
+#include "layer.h"
+#include "macro.h"
+#include "mousekeys.h"
+#include "taphold.h"
+
+#define TEST_LOOP_US 100 // simulated duration of one loop() pass
+
+static const uint8_t testPins[] = {9, 8, 7, 6, 10, 16, 14, 15};
+
+// Binding of a key in a test keymap, keys not listed are empty
+typedef struct TTestBinding {
+  uint8_t layer;
+  uint8_t key;
+  uint8_t length;
+  uint8_t bytes[6];
+} TTestBinding;
+
+static void runFor(uint32_t us)
+{
+  for (uint32_t t = 0; t < us; t += TEST_LOOP_US) {
+    loop();
+    nativeAdvanceUs(TEST_LOOP_US);
+  }
+}
+
+static void keyDown(uint8_t key)
+{
+  nativeSetPin(testPins[key], LOW);
+}
+
+static void keyUp(uint8_t key)
+{
+  nativeSetPin(testPins[key], HIGH);
+}
+
+// Holds the key for ms, the contact bounces for the first bounceMs of the press and the release
+static void keyTap(uint8_t key, uint32_t ms, uint32_t bounceMs)
+{
+  for (uint32_t t = 0; t < bounceMs; t++) {
+    nativeSetPin(testPins[key], (t & 1) ? HIGH : LOW);
+    runFor(1000);
+  }
+  keyDown(key);
+  runFor((ms - bounceMs) * 1000);
+  for (uint32_t t = 0; t < bounceMs; t++) {
+    nativeSetPin(testPins[key], (t & 1) ? LOW : HIGH);
+    runFor(1000);
+  }
+  keyUp(key);
+}
+
+// Sends one request over Raw HID and runs the firmware until the reply, false without one
+static bool testRequest(TConfigPacket *packet)
+{
+  uint8_t report[1 + sizeof(*packet)] = {HRAWHID_REPORT_ID};
+  memcpy(report + 1, packet, sizeof(*packet));
+  uint32_t seen = nativeReportCount();
+  if (!nativeSetReport(HID_REPORT_TYPE_OUTPUT, report, sizeof(report))) {
+    return false;
+  }
+  for (uint32_t t = 0; t < 500000; t += TEST_LOOP_US) {
+    loop();
+    nativeAdvanceUs(TEST_LOOP_US);
+    for (; seen < nativeReportCount(); seen++) {
+      if (nativeReport(seen)->id == HRAWHID_REPORT_ID) {
+        memcpy(packet, nativeReport(seen)->data, sizeof(*packet));
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Makes the keymap the one in use the way tools/keypadcfg load does
+static void testUpload(const uint8_t *map, uint16_t size)
+{
+  TConfigPacket packet;
+  uint16_t crc = 0xFFFF;
+  for (uint16_t offset = 0; offset < size; offset += CONFIG_PAGE_SIZE) {
+    packet = {};
+    packet.command = CONFIG_WRITE;
+    packet.offset = offset;
+    packet.length = (size - offset < CONFIG_PAGE_SIZE) ? size - offset : CONFIG_PAGE_SIZE;
+    memcpy(packet.data, map + offset, packet.length);
+    TEST_ASSERT_TRUE_MESSAGE(testRequest(&packet), "no reply to the keymap write");
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_OK, packet.status);
+  }
+  for (uint16_t i = 0; i < size; i++) {
+    crc = _crc_ccitt_update(crc, map[i]);
+  }
+  packet = {};
+  packet.command = CONFIG_COMMIT;
+  packet.length = size;
+  packet.crc = crc;
+  TEST_ASSERT_TRUE_MESSAGE(testRequest(&packet), "no reply to the keymap commit");
+  TEST_ASSERT_EQUAL_UINT8(CONFIG_OK, packet.status);
+  runFor(100000);
+  nativeClearReports();
+}
+
+// Uploads a keymap of the bindings
+static void testKeymap(const TTestBinding *bindings, uint8_t count)
+{
+  uint8_t map[KEYMAP_BINDINGS * 5];
+  uint16_t size = 0;
+  for (uint8_t layer = 0; layer < NUMBER_OF_LAYERS; layer++) {
+    for (uint8_t i = 0; i < NUMBER_OF_BINDINGS; i++) {
+      for (uint8_t b = 0; b < count; b++) {
+        if ((bindings[b].layer == layer) && (bindings[b].key == i)) {
+          memcpy(map + size, bindings[b].bytes, bindings[b].length);
+          size += bindings[b].length;
+        }
+      }
+      map[size++] = MACRO_END;
+    }
+  }
+  testUpload(map, size);
+}
+
+static bool keyboardHas(const TNativeReport *report, uint8_t code)
+{
+  return memchr(report->data + 2, code, 6);
+}
+
+// Count of keyboard reports in which the key code goes down
+static uint32_t keyPresses(uint8_t code)
+{
+  uint32_t presses = 0;
+  bool down = false;
+  for (uint32_t i = 0; i < nativeReportCount(); i++) {
+    const TNativeReport *report = nativeReport(i);
+    if (report->id == HID_REPORTID_KEYBOARD) {
+      bool now = keyboardHas(report, code);
+      presses += now && !down;
+      down = now;
+    }
+  }
+  return presses;
+}
+
+// Index of the first keyboard report from index first on with the key code down (up), -1 if none
+static int32_t keyboardReport(uint32_t first, uint8_t code, bool down)
+{
+  for (uint32_t i = first; i < nativeReportCount(); i++) {
+    const TNativeReport *report = nativeReport(i);
+    if ((report->id == HID_REPORTID_KEYBOARD) && (keyboardHas(report, code) == down)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Index of the first keyboard report with the modifiers and the key code (any key if 0), -1 if none
+static int32_t modifiersReport(uint8_t modifiers, uint8_t code)
+{
+  for (uint32_t i = 0; i < nativeReportCount(); i++) {
+    const TNativeReport *report = nativeReport(i);
+    if ((report->id == HID_REPORTID_KEYBOARD) && (report->data[0] == modifiers) && ((!code) || (keyboardHas(report, code)))) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Pointer move to the right summed over the mouse reports from index first on
+static int32_t mouseX(uint32_t first)
+{
+  int32_t x = 0;
+  for (uint32_t i = first; i < nativeReportCount(); i++) {
+    if (nativeReport(i)->id == HID_REPORTID_MOUSE) {
+      x += (int8_t)nativeReport(i)->data[1];
+    }
+  }
+  return x;
+}
+
+void setUp()
+{
+  nativeReset();
+  setup();
+  runFor(10000);
+  nativeClearReports();
+}
+
+void tearDown()
+{
+  for (uint8_t i = 0; i < sizeof(testPins); i++) {
+    keyUp(i);
+  }
+  runFor(1000000);
+}
+
+static void test_key_tap()
+{
+  keyTap(0, 60, 0);
+  runFor(100000);
+  TEST_ASSERT_EQUAL_UINT32(1, keyPresses(KEY_F13));
+  int32_t press = keyboardReport(0, KEY_F13, true);
+  TEST_ASSERT_NOT_EQUAL(-1, press);
+  TEST_ASSERT_NOT_EQUAL(-1, keyboardReport(press, KEY_F13, false));
+}
+
+// A bouncing contact is one press, a spike shorter than DEBOUNCING_MS none
+static void test_key_bounce()
+{
+  keyTap(0, 80, 6);
+  runFor(100000);
+  TEST_ASSERT_EQUAL_UINT32(1, keyPresses(KEY_F13));
+
+  nativeClearReports();
+  keyTap(1, DEBOUNCING_MS / 2, 0);
+  runFor(100000);
+  TEST_ASSERT_EQUAL_UINT32(0, keyPresses(KEY_F14));
+}
+
+// Feeds the level to debounce() once per millisecond, the contact bounces for the first
+// bounceMs. Returns the milliseconds until the debounced state of the key follows, -1 if it does
+// not within 100 ms.
+static int32_t debounceMs(bool level, uint16_t bounceMs)
+{
+  for (int32_t ms = 0; ms < 100; ms++) {
+    bool raw = ((ms < bounceMs) && (ms & 1)) ? !level : level;
+    if (((debounce(raw ? 1 : 0, millis()) & 1) != 0) == level) {
+      return ms;
+    }
+    nativeAdvanceUs(1000);
+  }
+  return -1;
+}
+
+static void test_debounce_defer()
+{
+  debounceBegin(0);
+  TEST_ASSERT_EQUAL_INT32(DEBOUNCING_MS, debounceMs(true, 0));
+  TEST_ASSERT_EQUAL_INT32(DEBOUNCING_MS, debounceMs(false, 0));
+  // the count starts over with every bounce
+  TEST_ASSERT_EQUAL_INT32(5 + DEBOUNCING_MS, debounceMs(true, 6));
+
+  // a spike shorter than DEBOUNCING_MS is not a press
+  debounceBegin(0);
+  uint32_t now = millis();
+  TEST_ASSERT_EQUAL_UINT64(0, debounce(1, now));
+  TEST_ASSERT_EQUAL_UINT64(0, debounce(1, now + 1));
+  for (uint8_t ms = 2; ms < 2 * DEBOUNCING_MS; ms++) {
+    TEST_ASSERT_EQUAL_UINT64(0, debounce(0, now + ms));
+  }
+  debounceBegin();
+}
+
+static void test_debounce_eager()
+{
+  debounceBegin(1);
+  TEST_ASSERT_EQUAL_INT32(0, debounceMs(true, 6));
+  // the release still waits until the contact settled
+  TEST_ASSERT_EQUAL_INT32(DEBOUNCING_MS, debounceMs(false, 0));
+  debounceBegin();
+}
+
+// The seventh key holds F19 for 50 ms, the press and the release go out as reports of their own
+static void test_sequencer()
+{
+  keyDown(6);
+  runFor(100000);
+  int32_t press = keyboardReport(0, KEY_F19, true);
+  TEST_ASSERT_NOT_EQUAL(-1, press);
+  int32_t release = keyboardReport(press, KEY_F19, false);
+  TEST_ASSERT_NOT_EQUAL(-1, release);
+  TEST_ASSERT_UINT32_WITHIN(2000, 50000, nativeReport(release)->timeUs - nativeReport(press)->timeUs);
+  keyUp(6);
+  runFor(100000);
+  TEST_ASSERT_EQUAL_UINT32(1, keyPresses(KEY_F19));
+
+  // taps in a row each go down and up
+  nativeClearReports();
+  for (uint8_t i = 0; i < 3; i++) {
+    keyTap(0, 30, 0);
+    runFor(30000);
+  }
+  runFor(100000);
+  TEST_ASSERT_EQUAL_UINT32(3, keyPresses(KEY_F13));
+}
+
+// A momentary layer key ends its layer even when its own slot in that layer has a binding
+static void test_layer_momentary()
+{
+  static const TTestBinding bindings[] = {
+    {0, 0, 2, {MACRO_LAYER_MOMENTARY(1)}},
+    {0, 1, 3, {MACRO_KEY(KEY_F14), MACRO_TAP}},
+    {1, 0, 3, {MACRO_KEY(KEY_F23), MACRO_TAP}},
+    {1, 1, 3, {MACRO_KEY(KEY_F15), MACRO_TAP}},
+  };
+  testKeymap(bindings, 4);
+
+  keyDown(0);
+  runFor(100000);
+  TEST_ASSERT_EQUAL_UINT8(1, layerTop());
+  keyTap(1, 60, 0);
+  runFor(100000);
+  TEST_ASSERT_EQUAL_UINT32(1, keyPresses(KEY_F15));
+  keyUp(0);
+  runFor(100000);
+  TEST_ASSERT_EQUAL_UINT8(0, layerTop());
+  TEST_ASSERT_EQUAL_UINT32(0, keyPresses(KEY_F23));
+
+  nativeClearReports();
+  keyTap(1, 60, 0);
+  runFor(100000);
+  TEST_ASSERT_EQUAL_UINT32(1, keyPresses(KEY_F14));
+  TEST_ASSERT_EQUAL_UINT32(0, keyPresses(KEY_F15));
+}
+
+// Two keys holding one layer, it ends with the last one
+static void test_layer_two_keys()
+{
+  static const TTestBinding bindings[] = {
+    {0, 0, 2, {MACRO_LAYER_MOMENTARY(1)}},
+    {0, 2, 2, {MACRO_LAYER_MOMENTARY(1)}},
+  };
+  testKeymap(bindings, 2);
+
+  keyDown(0);
+  runFor(50000);
+  keyDown(2);
+  runFor(50000);
+  keyUp(0);
+  runFor(50000);
+  TEST_ASSERT_EQUAL_UINT8(1, layerTop());
+  keyUp(2);
+  runFor(50000);
+  TEST_ASSERT_EQUAL_UINT8(0, layerTop());
+}
+
+// A one-shot layer is on for the next key only
+static void test_layer_oneshot()
+{
+  static const TTestBinding bindings[] = {
+    {0, 0, 2, {MACRO_LAYER_ONESHOT(1)}},
+    {0, 1, 3, {MACRO_KEY(KEY_F14), MACRO_TAP}},
+    {1, 1, 3, {MACRO_KEY(KEY_F15), MACRO_TAP}},
+  };
+  testKeymap(bindings, 3);
+
+  keyTap(0, 60, 0);
+  runFor(100000);
+  TEST_ASSERT_EQUAL_UINT8(1, layerTop());
+  keyTap(1, 60, 0);
+  runFor(100000);
+  TEST_ASSERT_EQUAL_UINT8(0, layerTop());
+  keyTap(1, 60, 0);
+  runFor(100000);
+  TEST_ASSERT_EQUAL_UINT32(1, keyPresses(KEY_F15));
+  TEST_ASSERT_EQUAL_UINT32(1, keyPresses(KEY_F14));
+}
+
+// SHIFT held, F13 tapped
+static void test_tap_hold()
+{
+  static const TTestBinding bindings[] = {
+    {0, 0, 5, {MACRO_HOLD_MOD(KEY_LEFT_SHIFT), MACRO_KEY(KEY_F13), MACRO_TAP}},
+    {0, 1, 3, {MACRO_KEY(KEY_F14), MACRO_TAP}},
+  };
+  testKeymap(bindings, 2);
+
+  keyTap(0, 80, 0);
+  runFor(300000);
+  TEST_ASSERT_EQUAL_UINT32(1, keyPresses(KEY_F13));
+  TEST_ASSERT_EQUAL_INT32(-1, modifiersReport(0x02, 0));
+
+  nativeClearReports();
+  keyDown(0);
+  runFor((TAP_HOLD_TERM_MS + 100) * 1000UL);
+  TEST_ASSERT_NOT_EQUAL(-1, modifiersReport(0x02, 0));
+  keyTap(1, 60, 0);
+  runFor(100000);
+  TEST_ASSERT_NOT_EQUAL(-1, modifiersReport(0x02, KEY_F14));
+  keyUp(0);
+  runFor(300000);
+  TEST_ASSERT_EQUAL_UINT32(0, keyPresses(KEY_F13));
+  TEST_ASSERT_EQUAL_UINT8(0, nativeReport(nativeReportCount() - 1)->data[0]);
+}
+
+// A tap-hold key and a layer key hold the same layer
+static void test_tap_hold_layer()
+{
+  static const TTestBinding bindings[] = {
+    {0, 0, 5, {MACRO_HOLD_LAYER(1), MACRO_KEY(KEY_F13), MACRO_TAP}},
+    {0, 2, 2, {MACRO_LAYER_MOMENTARY(1)}},
+  };
+  testKeymap(bindings, 2);
+
+  keyDown(0);
+  runFor((TAP_HOLD_TERM_MS + 100) * 1000UL);
+  TEST_ASSERT_EQUAL_UINT8(1, layerTop());
+  TEST_ASSERT_TRUE(tapHoldBusy()); // a keymap commit waits for the release of the hold
+  keyDown(2);
+  runFor(50000);
+  keyUp(0);
+  runFor(50000);
+  TEST_ASSERT_EQUAL_UINT8(1, layerTop());
+  keyUp(2);
+  runFor(50000);
+  TEST_ASSERT_EQUAL_UINT8(0, layerTop());
+  TEST_ASSERT_FALSE(tapHoldBusy());
+  TEST_ASSERT_EQUAL_UINT32(0, keyPresses(KEY_F13));
+}
+
+// A keymap of more than 256 bytes is taken and its last bindings play
+static void test_keymap_size()
+{
+  static const uint8_t wait[] = {MACRO_WAIT(1)};
+  static const uint8_t tap[] = {MACRO_KEY(KEY_F16), MACRO_TAP};
+  uint8_t map[KEYMAP_MAX_SIZE];
+  uint16_t size = 0;
+  for (uint16_t i = 0; i < KEYMAP_BINDINGS; i++) {
+    for (uint8_t w = 0; (i < 7) && (w < 12); w++) {
+      memcpy(map + size, wait, sizeof(wait));
+      size += sizeof(wait);
+    }
+    if (i == 7) {
+      TEST_ASSERT_GREATER_THAN_INT32(256, size); // the binding of the last key starts beyond 256 bytes
+      memcpy(map + size, tap, sizeof(tap));
+      size += sizeof(tap);
+    }
+    map[size++] = MACRO_END;
+  }
+  testUpload(map, size);
+
+  keyTap(7, 100, 0);
+  runFor(200000);
+  TEST_ASSERT_EQUAL_UINT32(1, keyPresses(KEY_F16));
+}
+
+// A key code or a modifier pressed by two sequences goes up with the later release
+static void test_shared_keys()
+{
+  static const TTestBinding bindings[] = {
+    {0, 0, 5, {MACRO_KEY(KEY_F14), MACRO_PRESS(300)}},
+    {0, 1, 5, {MACRO_KEY(KEY_F14), MACRO_PRESS(100)}},
+    {0, 2, 5, {MACRO_MOD(KEY_LEFT_SHIFT), MACRO_PRESS(300)}},
+    {0, 3, 5, {MACRO_MOD(KEY_LEFT_SHIFT), MACRO_KEY(KEY_F15), MACRO_TAP}},
+  };
+  testKeymap(bindings, 4);
+
+  keyDown(0);
+  runFor(50000);
+  keyDown(1);
+  runFor(400000);
+  int32_t press = keyboardReport(0, KEY_F14, true);
+  TEST_ASSERT_NOT_EQUAL(-1, press);
+  int32_t release = keyboardReport(press, KEY_F14, false);
+  TEST_ASSERT_NOT_EQUAL(-1, release);
+  TEST_ASSERT_UINT32_WITHIN(5000, 300000, nativeReport(release)->timeUs - nativeReport(press)->timeUs);
+  TEST_ASSERT_EQUAL_UINT32(1, keyPresses(KEY_F14));
+  keyUp(0);
+  keyUp(1);
+  runFor(100000);
+
+  // the second sequence releases F15 and its shift, the first one still holds the shift
+  nativeClearReports();
+  keyDown(2);
+  runFor(50000);
+  keyTap(3, 100, 0);
+  runFor(400000);
+  press = modifiersReport(0x02, KEY_F15);
+  TEST_ASSERT_NOT_EQUAL(-1, press);
+  release = keyboardReport(press, KEY_F15, false);
+  TEST_ASSERT_NOT_EQUAL(-1, release);
+  TEST_ASSERT_EQUAL_UINT8(0x02, nativeReport(release)->data[0]);
+  TEST_ASSERT_NOT_EQUAL(-1, modifiersReport(0, 0));
+}
+
+// The factory keymap binds the combo of the last two keys to F22
+static void test_combo()
+{
+  keyDown(6);
+  runFor(5000);
+  keyDown(7);
+  runFor(100000);
+  keyUp(6);
+  keyUp(7);
+  runFor(200000);
+  TEST_ASSERT_EQUAL_UINT32(1, keyPresses(KEY_F22));
+  TEST_ASSERT_EQUAL_UINT32(0, keyPresses(KEY_F19));
+  TEST_ASSERT_EQUAL_UINT32(0, keyPresses(KEY_F20));
+
+  // a key of the combo alone plays its own binding
+  nativeClearReports();
+  keyTap(6, 100, 0);
+  runFor(200000);
+  TEST_ASSERT_EQUAL_UINT32(1, keyPresses(KEY_F19));
+  TEST_ASSERT_EQUAL_UINT32(0, keyPresses(KEY_F22));
+}
+
+static void test_mouse_keys_release()
+{
+  static const TTestBinding bindings[] = {
+    {0, 0, 2, {MACRO_MOUSE_KEYS(MOUSE_KEY_RIGHT)}},
+    {0, 1, 2, {MACRO_MOUSE_KEYS(MOUSE_KEY_RIGHT)}},
+    {0, 2, 2, {MACRO_LAYER_ONESHOT(1)}},
+    {1, 3, 2, {MACRO_MOUSE_KEYS(MOUSE_KEY_RIGHT)}},
+  };
+  testKeymap(bindings, 4);
+
+  // the pointer moves while the key is down and stops with its release
+  keyDown(0);
+  runFor(100000);
+  TEST_ASSERT_TRUE(mouseKeysBusy());
+  uint32_t first = nativeReportCount();
+  runFor(100000);
+  TEST_ASSERT_GREATER_THAN_INT32(0, mouseX(first));
+  keyUp(0);
+  runFor(100000);
+  TEST_ASSERT_FALSE(mouseKeysBusy());
+  first = nativeReportCount();
+  runFor(100000);
+  TEST_ASSERT_EQUAL_INT32(0, mouseX(first));
+
+  // two keys on one direction, it ends with the last one
+  keyDown(0);
+  keyDown(1);
+  runFor(100000);
+  keyUp(0);
+  runFor(100000);
+  TEST_ASSERT_TRUE(mouseKeysBusy());
+  first = nativeReportCount();
+  runFor(100000);
+  TEST_ASSERT_GREATER_THAN_INT32(0, mouseX(first));
+  keyUp(1);
+  runFor(100000);
+  TEST_ASSERT_FALSE(mouseKeysBusy());
+
+  // the one-shot layer ends with the press, the release still stops the motion
+  keyTap(2, 50, 0);
+  runFor(50000);
+  keyDown(3);
+  runFor(100000);
+  TEST_ASSERT_TRUE(mouseKeysBusy());
+  TEST_ASSERT_EQUAL_UINT8(0, layerTop());
+  keyUp(3);
+  runFor(100000);
+  TEST_ASSERT_FALSE(mouseKeysBusy());
+  first = nativeReportCount();
+  runFor(100000);
+  TEST_ASSERT_EQUAL_INT32(0, mouseX(first));
+}
+
+// A full mouse ring sums moves only within the report range and never merges button changes
+static void test_mouse_queue()
+{
+  const THidQueueMouse move = {0, 100, 0, 0, 0};
+  const THidQueueMouse click = {MOUSE_LEFT, 0, 0, 0, 0};
+  for (uint8_t i = 0; i < HID_QUEUE_SIZE; i++) {
+    TEST_ASSERT_TRUE(hidQueuePush(HID_QUEUE_MOUSE, &move));
+  }
+  TEST_ASSERT_FALSE(hidQueuePush(HID_QUEUE_MOUSE, &move));
+  TEST_ASSERT_FALSE(hidQueuePush(HID_QUEUE_MOUSE, &click));
+  runFor(2000);
+  TEST_ASSERT_TRUE(hidQueuePush(HID_QUEUE_MOUSE, &click));
+  runFor(100000);
+  TEST_ASSERT_EQUAL_INT32(HID_QUEUE_SIZE * 100, mouseX(0));
+  int32_t clicks = 0;
+  for (uint32_t i = 0; i < nativeReportCount(); i++) {
+    clicks += (nativeReport(i)->id == HID_REPORTID_MOUSE) && (nativeReport(i)->data[0] == MOUSE_LEFT);
+  }
+  TEST_ASSERT_EQUAL_INT32(1, clicks);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_key_tap);
+  RUN_TEST(test_key_bounce);
+  RUN_TEST(test_debounce_defer);
+  RUN_TEST(test_debounce_eager);
+  RUN_TEST(test_sequencer);
+  RUN_TEST(test_layer_momentary);
+  RUN_TEST(test_layer_two_keys);
+  RUN_TEST(test_layer_oneshot);
+  RUN_TEST(test_tap_hold);
+  RUN_TEST(test_tap_hold_layer);
+  RUN_TEST(test_keymap_size);
+  RUN_TEST(test_shared_keys);
+  RUN_TEST(test_combo);
+  RUN_TEST(test_mouse_keys_release);
+  RUN_TEST(test_mouse_queue);
+  return UNITY_END();
+}
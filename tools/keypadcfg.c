@@ -0,0 +1,417 @@
+/*
+  keypadcfg - reads and replaces the keymap of the keypad over Raw HID (Linux hidraw)
+
+    cc -O2 -o keypadcfg tools/keypadcfg.c
+
+    keypadcfg [-d /dev/hidrawN] info          keymap in use, its size and checksum
+    keypadcfg [-d /dev/hidrawN] read FILE     saves the keymap in use (binary, as keymap[] in main.cpp)
+    keypadcfg [-d /dev/hidrawN] write FILE    uploads and activates a keymap, kept in EEPROM
+    keypadcfg [-d /dev/hidrawN] factory       back to the keymap built into the firmware
+    keypadcfg [-d /dev/hidrawN] stats         timing histograms and counters (firmware built with -DSTATS)
+    keypadcfg [-d /dev/hidrawN] stats-clear   starts the statistics again
+    keypadcfg [-d /dev/hidrawN] type [FILE]   types the text of the file or stdin (US layout)
+
+  A keymap file is the keymap[] byte stream with all layers, e.g. made from hex with xxd -r -p.
+  Without -d the first hidraw device with the Raw HID usage of the keypad is used. The user needs
+  read and write access to it, e.g. through a udev rule.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/hidraw.h>
+#include <sys/ioctl.h>
+#include "../include/configprotocol.h"
+
+#define REPORT_ID 3     // HRAWHID_REPORT_ID
+#define REPORT_SIZE 63  // HRAWHID_REPORT_SIZE
+#define TIMEOUT_MS 2000 // EEPROM writes take 3.4 ms per changed byte
+
+static const uint8_t usage[] = {0x06, 0xC0, 0xFF, 0x0A, 0x00, 0x0C}; // start of the report descriptor
+
+static uint16_t crcUpdate(uint16_t crc, uint8_t data)
+{
+  data ^= crc & 0xff;
+  data ^= data << 4;
+  return ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3));
+}
+
+static int openDevice(const char *path)
+{
+  if (path) {
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+      perror(path);
+    }
+    return fd;
+  }
+  for (int i = 0; i < 64; i++) {
+    char name[32];
+    snprintf(name, sizeof(name), "/dev/hidraw%d", i);
+    int fd = open(name, O_RDWR);
+    if (fd < 0) {
+      continue;
+    }
+    struct hidraw_report_descriptor desc;
+    int size = 0;
+    if ((ioctl(fd, HIDIOCGRDESCSIZE, &size) == 0) && (size >= (int)sizeof(usage))) {
+      desc.size = size;
+      if ((ioctl(fd, HIDIOCGRDESC, &desc) == 0) && (memcmp(desc.value, usage, sizeof(usage)) == 0)) {
+        return fd;
+      }
+    }
+    close(fd);
+  }
+  fprintf(stderr, "keypad not found, use -d /dev/hidrawN\n");
+  return -1;
+}
+
+// Sends the request and waits for its reply, returns the reply status or -1
+static int request(int fd, TConfigPacket *packet)
+{
+  uint8_t report[1 + REPORT_SIZE] = {REPORT_ID};
+  uint8_t command = packet->command;
+  memcpy(report + 1, packet, sizeof(*packet));
+  if (write(fd, report, sizeof(report)) < 0) {
+    perror("write");
+    return -1;
+  }
+  for (;;) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, TIMEOUT_MS) <= 0) {
+      fprintf(stderr, "no reply from the keypad\n");
+      return -1;
+    }
+    ssize_t n = read(fd, report, sizeof(report));
+    if (n < 0) {
+      perror("read");
+      return -1;
+    }
+    if ((n >= (ssize_t)(1 + sizeof(*packet))) && (report[0] == REPORT_ID) && (report[1] == command)) {
+      memcpy(packet, report + 1, sizeof(*packet));
+      return packet->status;
+    }
+  }
+}
+
+static int check(int status, const char *what)
+{
+  static const char *const errors[] = {"ok", "unknown command", "out of range", "checksum mismatch", "not a keymap for this keypad"};
+  if (status > 0) {
+    fprintf(stderr, "%s: %s\n", what, (status < (int)(sizeof(errors) / sizeof(errors[0]))) ? errors[status] : "error");
+  }
+  return status;
+}
+
+static int info(int fd, TConfigInfo *result, uint16_t *size, uint16_t *crc)
+{
+  TConfigPacket packet = {CONFIG_INFO};
+  if (check(request(fd, &packet), "info")) {
+    return -1;
+  }
+  memcpy(result, packet.data, sizeof(*result));
+  *size = packet.length;
+  *crc = packet.crc;
+  if (result->version != CONFIG_VERSION) {
+    fprintf(stderr, "keypad speaks protocol version %u, this tool %u\n", result->version, CONFIG_VERSION);
+    return -1;
+  }
+  return 0;
+}
+
+static int cmdInfo(int fd)
+{
+  TConfigInfo i;
+  uint16_t size, crc;
+  if (info(fd, &i, &size, &crc)) {
+    return 1;
+  }
+  printf("keymap: %s, %u of %u bytes, crc 0x%04X\n", (i.source == CONFIG_SOURCE_EEPROM) ? "uploaded" : "firmware",
+         size, i.maxSize, crc);
+  printf("keys: %u, layers: %u with %u bindings each\n", i.numberOfKeys, i.numberOfLayers, i.bindingsPerLayer);
+  return 0;
+}
+
+static int cmdRead(int fd, const char *file)
+{
+  TConfigInfo i;
+  uint16_t size, crc;
+  uint8_t keymap[65536];
+  if (info(fd, &i, &size, &crc)) {
+    return 1;
+  }
+  for (uint16_t offset = 0; offset < size; offset += CONFIG_PAGE_SIZE) {
+    TConfigPacket packet = {CONFIG_READ};
+    packet.offset = offset;
+    packet.length = (size - offset < CONFIG_PAGE_SIZE) ? size - offset : CONFIG_PAGE_SIZE;
+    if (check(request(fd, &packet), "read")) {
+      return 1;
+    }
+    memcpy(keymap + offset, packet.data, packet.length);
+  }
+  uint16_t sum = 0xFFFF;
+  for (uint16_t j = 0; j < size; j++) {
+    sum = crcUpdate(sum, keymap[j]);
+  }
+  if (sum != crc) {
+    fprintf(stderr, "read: keymap changed while reading, try again\n");
+    return 1;
+  }
+  FILE *f = fopen(file, "wb");
+  if ((!f) || (fwrite(keymap, 1, size, f) != size) || (fclose(f) != 0)) {
+    perror(file);
+    return 1;
+  }
+  printf("%u bytes saved to %s\n", size, file);
+  return 0;
+}
+
+static int cmdWrite(int fd, const char *file)
+{
+  TConfigInfo i;
+  uint16_t size, crc;
+  uint8_t keymap[65536];
+  if (info(fd, &i, &size, &crc)) {
+    return 1;
+  }
+  FILE *f = fopen(file, "rb");
+  if (!f) {
+    perror(file);
+    return 1;
+  }
+  size = fread(keymap, 1, sizeof(keymap), f);
+  fclose(f);
+  if ((size == 0) || (size > i.maxSize)) {
+    fprintf(stderr, "%s: %u bytes, the keypad takes 1 to %u\n", file, size, i.maxSize);
+    return 1;
+  }
+  crc = 0xFFFF;
+  for (uint16_t j = 0; j < size; j++) {
+    crc = crcUpdate(crc, keymap[j]);
+  }
+  // pages are programmed before the reply, only bytes that differ from the slot cost time
+  for (uint16_t offset = 0; offset < size; offset += i.pageSize) {
+    TConfigPacket packet = {CONFIG_WRITE};
+    packet.offset = offset;
+    packet.length = (size - offset < i.pageSize) ? size - offset : i.pageSize;
+    memcpy(packet.data, keymap + offset, packet.length);
+    if (check(request(fd, &packet), "write")) {
+      return 1;
+    }
+  }
+  TConfigPacket packet = {CONFIG_COMMIT};
+  packet.length = size;
+  packet.crc = crc;
+  if (check(request(fd, &packet), "commit")) {
+    return 1;
+  }
+  printf("%u bytes written, crc 0x%04X\n", size, crc);
+  return 0;
+}
+
+static int cmdFactory(int fd)
+{
+  TConfigPacket packet = {CONFIG_FACTORY};
+  if (check(request(fd, &packet), "factory")) {
+    return 1;
+  }
+  printf("using the keymap built into the firmware\n");
+  return 0;
+}
+
+static void printHistogram(const char *name, const TConfigHistogram *h, double cyclesPerUs)
+{
+  printf("%s: %u samples", name, h->count);
+  if (h->count == 0) {
+    printf("\n");
+    return;
+  }
+  printf(", min %.1f us, avg %.1f us, max %.1f us\n", h->min / cyclesPerUs, h->sum / cyclesPerUs / h->count,
+         h->max / cyclesPerUs);
+  uint16_t most = 1;
+  for (int b = 0; b < STATS_BUCKETS; b++) {
+    most = (h->bucket[b] > most) ? h->bucket[b] : most;
+  }
+  for (int b = 0; b < STATS_BUCKETS; b++) {
+    if (h->bucket[b] == 0) {
+      continue;
+    }
+    double from = b ? (1UL << (b + STATS_BUCKET_SHIFT - 1)) / cyclesPerUs : 0.0;
+    char bar[41];
+    int length = (h->bucket[b] * 40 + most - 1) / most;
+    memset(bar, '#', length);
+    bar[length] = 0;
+    if (b == STATS_BUCKETS - 1) {
+      printf("  %10.1f us and more  %5u%s %s\n", from, h->bucket[b], (h->bucket[b] == 0xFFFF) ? "+" : " ", bar);
+    } else {
+      printf("  %10.1f us to %7.1f %5u%s %s\n", from, (1UL << (b + STATS_BUCKET_SHIFT)) / cyclesPerUs, h->bucket[b],
+             (h->bucket[b] == 0xFFFF) ? "+" : " ", bar);
+    }
+  }
+}
+
+static int cmdStats(int fd)
+{
+  static const char *const histograms[STATS_HISTOGRAMS] = {
+    "loop period", "checkKeys()", "encoder pin interrupt", "key change to report", "report send"};
+  TConfigStats stats;
+  for (uint16_t offset = 0; offset < sizeof(stats); offset += CONFIG_PAGE_SIZE) {
+    TConfigPacket packet = {CONFIG_STATS};
+    packet.offset = offset;
+    packet.length = (sizeof(stats) - offset < CONFIG_PAGE_SIZE) ? sizeof(stats) - offset : CONFIG_PAGE_SIZE;
+    int status = request(fd, &packet);
+    if (status == CONFIG_ERROR_COMMAND) {
+      fprintf(stderr, "stats: the firmware was built without -DSTATS\n");
+      return 1;
+    }
+    if (check(status, "stats")) {
+      return 1;
+    }
+    memcpy((uint8_t *)&stats + offset, packet.data, packet.length);
+  }
+  double cyclesPerUs = stats.cpuHz / 1e6;
+  printf("statistics of the last %.1f s\n", stats.uptimeMs / 1000.0);
+  for (int i = 0; i < STATS_HISTOGRAMS; i++) {
+    printHistogram(histograms[i], &stats.histogram[i], cyclesPerUs);
+  }
+  printf("encoder steps dropped: %u, sent together with earlier steps: %u\n", stats.counter[STATS_ENCODER_DROPPED],
+         stats.counter[STATS_ENCODER_COALESCED]);
+  printf("reports merged while queued: %u, dropped: %u\n", stats.counter[STATS_REPORTS_MERGED],
+         stats.counter[STATS_REPORTS_DROPPED]);
+  return 0;
+}
+
+static int cmdStatsClear(int fd)
+{
+  TConfigPacket packet = {CONFIG_STATS_CLEAR};
+  int status = request(fd, &packet);
+  if (status == CONFIG_ERROR_COMMAND) {
+    fprintf(stderr, "stats-clear: the firmware was built without -DSTATS\n");
+    return 1;
+  }
+  return check(status, "stats-clear") ? 1 : 0;
+}
+
+static double seconds(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static int cmdType(int fd, const char *file)
+{
+  FILE *f = ((!file) || (strcmp(file, "-") == 0)) ? stdin : fopen(file, "rb");
+  if (!f) {
+    perror(file);
+    return 1;
+  }
+  static uint8_t keys[2 * 1048576];
+  size_t count = 0, skipped = 0;
+  for (int c; ((c = fgetc(f)) != EOF) && (count < sizeof(keys) / 2);) {
+    if (configTypeKey((char)c, &keys[2 * count], &keys[2 * count + 1])) {
+      count++;
+    }
+    else if (c != '\r') {
+      skipped++;
+    }
+  }
+  if (f != stdin) {
+    fclose(f);
+  }
+
+  // every reply tells how many keys the keypad takes next, a request without keys only asks
+  double start = seconds();
+  size_t sent = 0;
+  uint16_t credit = 0, pending;
+  do {
+    TConfigPacket packet = {CONFIG_TYPE};
+    size_t n = count - sent;
+    n = (n < credit) ? n : credit;
+    n = (n < CONFIG_PAGE_SIZE / 2) ? n : CONFIG_PAGE_SIZE / 2;
+    packet.length = 2 * n;
+    memcpy(packet.data, keys + 2 * sent, packet.length);
+    int status = request(fd, &packet);
+    if (status == CONFIG_ERROR_COMMAND) {
+      fprintf(stderr, "type: the firmware cannot type text\n");
+      return 1;
+    }
+    if (check(status, "type")) {
+      return 1;
+    }
+    sent += n;
+    credit = packet.offset;
+    pending = packet.length;
+    if ((credit == 0) || (sent == count)) {
+      usleep(1000); // a key per USB frame at most
+    }
+  } while ((sent < count) || (pending));
+  double elapsed = seconds() - start;
+  printf("%zu characters in %.3f s, %.0f characters/s", count, elapsed, (elapsed > 0) ? count / elapsed : 0.0);
+  if (skipped) {
+    printf(", %zu without a key skipped", skipped);
+  }
+  printf("\n");
+  return 0;
+}
+
+static int printUsage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-d /dev/hidrawN] info | read FILE | write FILE | factory | stats | stats-clear | type [FILE]\n", name);
+  return 2;
+}
+
+int main(int argc, char **argv)
+{
+  const char *device = NULL;
+  int arg = 1;
+  if ((argc > 2) && (strcmp(argv[1], "-d") == 0)) {
+    device = argv[2];
+    arg = 3;
+  }
+  if (arg >= argc) {
+    return printUsage(argv[0]);
+  }
+  const char *cmd = argv[arg];
+  const char *file = (arg + 1 < argc) ? argv[arg + 1] : NULL;
+  if (((strcmp(cmd, "read") == 0) || (strcmp(cmd, "write") == 0)) && (!file)) {
+    return printUsage(argv[0]);
+  }
+
+  int fd = openDevice(device);
+  if (fd < 0) {
+    return 1;
+  }
+  int ret;
+  if (strcmp(cmd, "info") == 0) {
+    ret = cmdInfo(fd);
+  }
+  else if (strcmp(cmd, "read") == 0) {
+    ret = cmdRead(fd, file);
+  }
+  else if (strcmp(cmd, "write") == 0) {
+    ret = cmdWrite(fd, file);
+  }
+  else if (strcmp(cmd, "factory") == 0) {
+    ret = cmdFactory(fd);
+  }
+  else if (strcmp(cmd, "stats") == 0) {
+    ret = cmdStats(fd);
+  }
+  else if (strcmp(cmd, "stats-clear") == 0) {
+    ret = cmdStatsClear(fd);
+  }
+  else if (strcmp(cmd, "type") == 0) {
+    ret = cmdType(fd, file);
+  }
+  else {
+    ret = printUsage(argv[0]);
+  }
+  close(fd);
+  return ret;
+}